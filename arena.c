@@ -0,0 +1,100 @@
+#include "arena.h"
+#include <string.h>
+
+#define ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+void initArena(Arena *arena)
+{
+    arena->blocks = NULL;
+}
+
+static ArenaBlock *allocateBlock(size_t capacity)
+{
+    ArenaBlock *block = malloc(sizeof(ArenaBlock) + capacity);
+
+    if (block == NULL)
+    {
+        printf("Falied failed allocating memory\n");
+        exit(71);
+    }
+
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+
+    return block;
+}
+
+static void *bump(Arena *arena, size_t size)
+{
+    ArenaBlock *block = arena->blocks;
+
+    if (block == NULL || block->capacity - block->used < size)
+    {
+        // big allocations get a block of their own that's kept behind the current one
+        if (size > ARENA_BLOCK_SIZE / 4 && block != NULL)
+        {
+            ArenaBlock *big = allocateBlock(size);
+            big->used = size;
+            big->next = block->next;
+            block->next = big;
+            return big->data;
+        }
+
+        block = allocateBlock(size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    void *result = block->data + block->used;
+    block->used += size;
+
+    return result;
+}
+
+// works like `reallocate` but the old memory is only abandoned not freed
+void *arenaGrow(Arena *arena, void *pointer, size_t oldSize, size_t newSize)
+{
+    ArenaBlock *block = arena->blocks;
+    size_t oldAligned = ALIGN(oldSize), newAligned = ALIGN(newSize);
+
+    // the last allocation can be grown in place
+    if (pointer != NULL && block != NULL && (uint8_t *)pointer + oldAligned == block->data + block->used && block->capacity - block->used >= newAligned - oldAligned)
+    {
+        block->used += newAligned - oldAligned;
+        return pointer;
+    }
+
+    void *result = bump(arena, newAligned);
+
+    if (pointer != NULL)
+        memcpy(result, pointer, oldSize < newSize ? oldSize : newSize);
+
+    return result;
+}
+
+// frees every block except the current one which gets reused
+void resetArena(Arena *arena)
+{
+    if (arena->blocks == NULL)
+        return;
+
+    ArenaBlock *block = arena->blocks->next;
+
+    while (block != NULL)
+    {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    arena->blocks->next = NULL;
+    arena->blocks->used = 0;
+}
+
+void freeArena(Arena *arena)
+{
+    resetArena(arena);
+    free(arena->blocks);
+    initArena(arena);
+}
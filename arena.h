@@ -0,0 +1,31 @@
+#ifndef clox_arena_h
+#define clox_arena_h
+
+#include "common.h"
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next;
+    size_t capacity;
+    size_t used;
+    uint8_t data[];
+} ArenaBlock;
+
+// A bump allocator for short-lived data, its memory isn't tracked by the GC
+// and gets released all at once by `resetArena`
+typedef struct
+{
+    ArenaBlock *blocks; // the first one is the one we bump into
+} Arena;
+
+void initArena(Arena *);
+
+void *arenaGrow(Arena *, void *, size_t, size_t);
+
+void resetArena(Arena *);
+
+void freeArena(Arena *);
+
+#endif
@@ -0,0 +1,73 @@
+/*
+    Compares the old byte-at-a-time FNV-1a with `hashString` at different key
+    lengths, build it from the root of the repo with:
+        gcc -O2 -fcommon -I. -o hashing-bench benchmarks/hashing.c $(ls *.c | grep -v main.c) -lm
+*/
+
+#include "memory.h"
+#include <string.h>
+#include <time.h>
+
+#define TOTAL_BYTES (256 * 1024 * 1024)
+
+static uint32_t fnv1a(char *key, int length)
+{
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < length; i++)
+    {
+        hash ^= (uint8_t)key[i];
+        hash *= 16777619;
+    }
+
+    return hash;
+}
+
+// returns the throughput in GB/s
+static double measure(uint32_t (*function)(char *, int), char *keys, int length, uint32_t *sink)
+{
+    // called through a volatile pointer so neither function gets inlined
+    uint32_t (*volatile hash)(char *, int) = function;
+    long rounds = TOTAL_BYTES / length;
+    clock_t start = clock();
+
+    // the offset changes the key a bit each round so nothing gets hoisted
+    for (long i = 0; i < rounds; i++)
+        *sink ^= hash(keys + (i & 63), length);
+
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    return (double)rounds * length / seconds / 1e9;
+}
+
+int main()
+{
+    int lengths[] = {4, 8, 12, 16, 32, 64, 256, 4096};
+    int maxLength = lengths[sizeof(lengths) / sizeof(lengths[0]) - 1];
+    char *keys = malloc(maxLength + 64);
+    uint32_t sink = 0;
+
+    initVm();
+
+    for (int i = 0; i < maxLength + 64; i++)
+        keys[i] = 'a' + i % 26;
+
+    printf("%6s %12s %12s\n", "length", "fnv1a", "hashString");
+
+    for (int i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+    {
+        double old = measure(fnv1a, keys, lengths[i], &sink);
+        double new = measure(hashString, keys, lengths[i], &sink);
+
+        printf("%6d %7.2f GB/s %7.2f GB/s\n", lengths[i], old, new);
+    }
+
+    // keeps the hashes from being optimized away
+    if (sink == 42)
+        putchar('\n');
+
+    free(keys);
+    freeVm();
+
+    return 0;
+}
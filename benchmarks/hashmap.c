@@ -0,0 +1,89 @@
+/*
+    Measures the insert, get, and remove throughput of `HashMap` at different
+    sizes, build it from the root of the repo with:
+        gcc -O2 -fcommon -I. -o hashmap-bench benchmarks/hashmap.c $(ls *.c | grep -v main.c) -lm
+    (add -DSWISS_HASHMAP to measure the swiss table)
+*/
+
+#include "memory.h"
+#include <time.h>
+
+#define TOTAL_OPERATIONS 4000000
+
+static double secondsSince(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void report(char *operation, int size, long operations, double seconds)
+{
+    printf("%-6s %8d keys: %7.2f M ops/s\n", operation, size, operations / seconds / 1e6);
+}
+
+static void benchmark(ObjString **keys, int size)
+{
+    int rounds = TOTAL_OPERATIONS / size;
+    long operations = (long)rounds * size;
+    double insertTime = 0, getTime = 0, removeTime = 0;
+    double sum = 0;
+
+    for (int round = 0; round < rounds; round++)
+    {
+        HashMap hashMap;
+        initHashMap(&hashMap);
+
+        clock_t start = clock();
+        for (int i = 0; i < size; i++)
+            hashMapInsert(&hashMap, keys[i], NUMBER(i));
+        insertTime += secondsSince(start);
+
+        start = clock();
+        for (int i = 0; i < size; i++)
+            sum += AS_NUMBER(*hashMapGet(&hashMap, keys[i]));
+        getTime += secondsSince(start);
+
+        start = clock();
+        for (int i = 0; i < size; i++)
+            hashMapRemove(&hashMap, keys[i]);
+        removeTime += secondsSince(start);
+
+        freeHashMap(&hashMap);
+    }
+
+    report("insert", size, operations, insertTime);
+    report("get", size, operations, getTime);
+    report("remove", size, operations, removeTime);
+
+    // keeps the lookups from being optimized away
+    if (sum < 0)
+        putchar('\n');
+}
+
+int main()
+{
+    int sizes[] = {16, 1000, 100000, 1000000};
+    int maxSize = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+
+    initVm();
+
+    // the keys aren't rooted anywhere
+    vm.deferGc++;
+
+    ObjString **keys = malloc(sizeof(ObjString *) * maxSize);
+    char buffer[32];
+
+    for (int i = 0; i < maxSize; i++)
+    {
+        int length = sprintf(buffer, "key%d", i);
+        keys[i] = allocateObjString(buffer, length);
+    }
+
+    for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        benchmark(keys, sizes[i]);
+
+    free(keys);
+    vm.deferGc--;
+    freeVm();
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+    Compares the kernels of `simd.h` with plain loops over the same doubles,
+    build it from the root of the repo with:
+        gcc -O2 -fcommon -I. -o simd-bench benchmarks/simd.c $(ls *.c | grep -v main.c) -lm
+    (add -mavx to get the AVX versions)
+*/
+
+#include "simd.h"
+#include <stdlib.h>
+#include <time.h>
+
+#define LENGTH 4096
+#define ROUNDS 100000
+
+static double plainSum(double *values, size_t count)
+{
+    double sum = 0;
+
+    for (size_t i = 0; i < count; i++)
+        sum += values[i];
+
+    return sum;
+}
+
+static double plainDot(double *a, double *b, size_t count)
+{
+    double sum = 0;
+
+    for (size_t i = 0; i < count; i++)
+        sum += a[i] * b[i];
+
+    return sum;
+}
+
+static double plainMin(double *values, size_t count)
+{
+    double min = values[0];
+
+    for (size_t i = 1; i < count; i++)
+        if (values[i] < min)
+            min = values[i];
+
+    return min;
+}
+
+static double simdSum(double *values, size_t count)
+{
+    return sumDoubles(values, count);
+}
+
+static double simdDot(double *a, double *b, size_t count)
+{
+    return dotDoubles(a, b, count);
+}
+
+static double simdMin(double *values, size_t count)
+{
+    return minDoubles(values, count);
+}
+
+// returns the throughput in millions of doubles per second
+static double measureReduction(double (*function)(double *, size_t), double *values, double *sink)
+{
+    // called through a volatile pointer so neither function gets inlined
+    double (*volatile reduce)(double *, size_t) = function;
+    clock_t start = clock();
+
+    for (int i = 0; i < ROUNDS; i++)
+        *sink += reduce(values, LENGTH);
+
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    return (double)ROUNDS * LENGTH / seconds / 1e6;
+}
+
+static double measureDot(double (*function)(double *, double *, size_t), double *a, double *b, double *sink)
+{
+    double (*volatile dot)(double *, double *, size_t) = function;
+    clock_t start = clock();
+
+    for (int i = 0; i < ROUNDS; i++)
+        *sink += dot(a, b, LENGTH);
+
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    return (double)ROUNDS * LENGTH / seconds / 1e6;
+}
+
+int main()
+{
+    double *a = malloc(sizeof(double) * LENGTH);
+    double *b = malloc(sizeof(double) * LENGTH);
+    double sink = 0;
+
+    for (int i = 0; i < LENGTH; i++)
+    {
+        a[i] = (double)rand() / RAND_MAX;
+        b[i] = (double)rand() / RAND_MAX;
+    }
+
+    printf("%6s %14s %14s\n", "kernel", "plain", "simd");
+    printf("%6s %8.0f M/s %8.0f M/s\n", "sum", measureReduction(plainSum, a, &sink), measureReduction(simdSum, a, &sink));
+    printf("%6s %8.0f M/s %8.0f M/s\n", "min", measureReduction(plainMin, a, &sink), measureReduction(simdMin, a, &sink));
+    printf("%6s %8.0f M/s %8.0f M/s\n", "dot", measureDot(plainDot, a, b, &sink), measureDot(simdDot, a, b, &sink));
+
+    // keeps the results from being optimized away
+    if (sink == 42)
+        putchar('\n');
+
+    free(a);
+    free(b);
+
+    return 0;
+}
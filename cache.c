@@ -0,0 +1,239 @@
+#include "cache.h"
+#include "serial.h"
+#include "memory.h"
+#include <string.h>
+
+typedef enum
+{
+    CONSTANT_BOOL,
+    CONSTANT_NIL,
+    CONSTANT_NUMBER,
+    CONSTANT_STRING,
+    CONSTANT_FUNCTION,
+} ConstantTag;
+
+//> WRITING
+static void writeString(Writer *writer, ObjString *string)
+{
+    if (string == NULL)
+    {
+        writeU32(writer, UINT32_MAX);
+        return;
+    }
+
+    writeU32(writer, string->length);
+    writeBytes(writer, string->chars, string->length);
+}
+
+static void writeFunction(Writer *writer, ObjFunction *function)
+{
+    Chunk *chunk = &function->chunk;
+
+    writeString(writer, function->name);
+    writeU8(writer, function->arity);
+
+    writeU32(writer, chunk->count);
+    writeBytes(writer, chunk->code, chunk->count);
+
+    writeU32(writer, chunk->positions.count);
+    writeBytes(writer, chunk->positions.bytes, chunk->positions.count);
+
+    writeU32(writer, chunk->constants.count);
+    for (size_t i = 0; i < chunk->constants.count; i++)
+    {
+        Value value = chunk->constants.values[i];
+
+        switch (value.type)
+        {
+        case VAL_BOOL:
+            writeU8(writer, CONSTANT_BOOL);
+            writeU8(writer, AS_BOOL(value));
+            break;
+        case VAL_NIL:
+            writeU8(writer, CONSTANT_NIL);
+            break;
+        case VAL_NUMBER:
+            writeU8(writer, CONSTANT_NUMBER);
+            writeDouble(writer, AS_NUMBER(value));
+            break;
+        case VAL_OBJ:
+            if (IS_STRING(value))
+            {
+                writeU8(writer, CONSTANT_STRING);
+                writeString(writer, AS_STRING(value));
+            }
+            else
+            {
+                writeU8(writer, CONSTANT_FUNCTION);
+                writeFunction(writer, AS_FUNCTION(value));
+            }
+            break;
+        }
+    }
+}
+
+// returns whether the file got written
+bool writeCache(char *path, ObjFunction *script, char *source)
+{
+    Writer writer;
+    size_t sourceLength = strlen(source);
+
+    initWriter(&writer);
+
+    writeBytes(&writer, CACHE_MAGIC, strlen(CACHE_MAGIC));
+    writeU32(&writer, CACHE_VERSION);
+    writeU32(&writer, sourceLength);
+
+    uint64_t hash = hashBytes(source, sourceLength);
+    writeBytes(&writer, &hash, sizeof(hash));
+
+    writeFunction(&writer, script);
+
+    bool written = writeToFile(&writer, path);
+
+    freeWriter(&writer);
+
+    return written;
+}
+//<
+
+//> LOADING
+static ObjString *readString(Reader *reader)
+{
+    uint32_t length = readU32(reader);
+
+    if (length == UINT32_MAX)
+        return NULL;
+
+    char *chars = readBytes(reader, length);
+
+    if (chars == NULL)
+        return NULL;
+
+    return allocateObjString(chars, length);
+}
+
+// the function is kept on the stack while it's being filled
+static ObjFunction *readFunction(Reader *reader, char *source)
+{
+    ObjFunction *function = allocateObjFunction();
+    Chunk *chunk = &function->chunk;
+
+    push(OBJ(function));
+
+    function->name = readString(reader);
+    function->arity = readU8(reader);
+
+    uint32_t count = readU32(reader);
+    uint8_t *code = readBytes(reader, count);
+
+    if (code == NULL)
+        goto failed;
+
+    chunk->code = ALLOCATE(uint8_t, count);
+    memcpy(chunk->code, code, count);
+    chunk->count = chunk->capacity = count;
+
+    count = readU32(reader);
+    uint8_t *positions = readBytes(reader, count);
+
+    if (positions == NULL)
+        goto failed;
+
+    chunk->positions.bytes = ALLOCATE(uint8_t, count);
+    memcpy(chunk->positions.bytes, positions, count);
+    chunk->positions.count = chunk->positions.capacity = count;
+    chunk->source = source;
+
+    count = readU32(reader);
+
+    // every constant takes at least its tag byte, so a bigger count is corrupt
+    if (reader->failed || count > (size_t)(reader->end - reader->current))
+        goto failed;
+
+    chunk->constants.values = ALLOCATE(Value, count);
+    chunk->constants.capacity = count;
+
+    for (uint32_t i = 0; i < count && !reader->failed; i++)
+    {
+        Value value = NIL;
+
+        switch (readU8(reader))
+        {
+        case CONSTANT_BOOL:
+            value = BOOL(readU8(reader));
+            break;
+        case CONSTANT_NIL:
+            break;
+        case CONSTANT_NUMBER:
+            value = NUMBER(readDouble(reader));
+            break;
+        case CONSTANT_STRING:
+        {
+            ObjString *string = readString(reader);
+
+            if (string != NULL)
+                value = OBJ(string);
+            else
+                reader->failed = true;
+
+            break;
+        }
+        case CONSTANT_FUNCTION:
+        {
+            ObjFunction *nested = readFunction(reader, source);
+
+            if (nested != NULL)
+                value = OBJ(nested);
+
+            break;
+        }
+        default:
+            reader->failed = true;
+        }
+
+        chunk->constants.values[chunk->constants.count++] = value;
+    }
+
+    if (reader->failed)
+        goto failed;
+
+    pop();
+    return function;
+
+failed:
+    reader->failed = true;
+    pop();
+    return NULL;
+}
+
+// returns the cached <script> function or NULL if the cache is missing or stale
+ObjFunction *loadCache(char *path, char *source)
+{
+    size_t size;
+    uint8_t *bytes = mapFile(path, &size);
+
+    if (bytes == NULL)
+        return NULL;
+
+    Reader reader = {bytes, bytes + size, false};
+    size_t sourceLength = strlen(source);
+    ObjFunction *script = NULL;
+
+    char *magic = readBytes(&reader, strlen(CACHE_MAGIC));
+    uint32_t version = readU32(&reader);
+    uint32_t cachedLength = readU32(&reader);
+    uint64_t hash = 0;
+    void *storedHash = readBytes(&reader, sizeof(hash));
+
+    if (storedHash != NULL)
+        memcpy(&hash, storedHash, sizeof(hash));
+
+    if (!reader.failed && memcmp(magic, CACHE_MAGIC, strlen(CACHE_MAGIC)) == 0 && version == CACHE_VERSION && cachedLength == sourceLength && hash == hashBytes(source, sourceLength))
+        script = readFunction(&reader, source);
+
+    unmapFile(bytes, size);
+
+    return script;
+}
+//<
@@ -0,0 +1,23 @@
+#ifndef clox_cache_h
+#define clox_cache_h
+
+#include "common.h"
+#include "object.h"
+
+#define CACHE_MAGIC "LOXC"
+#define CACHE_VERSION 3
+
+/*
+    A `.loxc` file holds the compiled <script> function of a source file so
+    it can be run without scanning and compiling it again, its layout is:
+        * header: magic, version, source length, and source hash
+        * function: name, arity, code, position table, and constants
+          (nested functions are written in place of their constants)
+    It's only valid for the exact source it was compiled from.
+*/
+
+bool writeCache(char *, ObjFunction *, char *);
+
+ObjFunction *loadCache(char *, char *);
+
+#endif
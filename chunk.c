@@ -1,24 +1,107 @@
 #include "chunk.h"
 #include "memory.h"
+#include <string.h>
 
-void initTokenArr(TokenArr *tokenArr)
+void initPositionTable(PositionTable *positions)
 {
-    tokenArr->capacity = 0;
-    tokenArr->count = 0;
-    tokenArr->tokens = NULL;
+    positions->count = 0;
+    positions->capacity = 0;
+    positions->bytes = NULL;
+    positions->lastOffset = 0;
+    positions->lastStart = 0;
+    positions->lastLength = -1;
 }
 
-static void writeTokenArr(TokenArr *tokenArr, Token *token)
+static void writePositionByte(PositionTable *positions, uint8_t byte)
 {
-    if (tokenArr->count == tokenArr->capacity)
+    if (positions->count == positions->capacity)
     {
-        size_t oldCapacity = tokenArr->capacity;
-        tokenArr->capacity = GROW_CAPACITY(tokenArr->capacity);
+        size_t oldCapacity = positions->capacity;
+        positions->capacity = GROW_CAPACITY(positions->capacity);
 
-        tokenArr->tokens = GROW_ARRAY(Token, tokenArr->tokens, oldCapacity, tokenArr->capacity);
+        positions->bytes = GROW_ARENA_ARRAY(uint8_t, positions->bytes, oldCapacity, positions->capacity);
     }
 
-    tokenArr->tokens[tokenArr->count++] = *token;
+    positions->bytes[positions->count++] = byte;
+}
+
+static void writeVarint(PositionTable *positions, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        writePositionByte(positions, (value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+
+    writePositionByte(positions, value);
+}
+
+static uint32_t readVarint(uint8_t **current)
+{
+    uint32_t value = 0;
+    int shift = 0;
+
+    while (**current & 0x80)
+    {
+        value |= (uint32_t)(*(*current)++ & 0x7f) << shift;
+        shift += 7;
+    }
+
+    return value | (uint32_t)(*(*current)++) << shift;
+}
+
+// only starts a new run if the token differs from the one of the last run
+static void writePosition(Chunk *chunk, int offset, Token *token)
+{
+    PositionTable *positions = &chunk->positions;
+    int start = token->start - chunk->source;
+
+    if (start == positions->lastStart && token->length == positions->lastLength)
+        return;
+
+    int delta = start - positions->lastStart;
+
+    writeVarint(positions, offset - positions->lastOffset);
+    writeVarint(positions, delta < 0 ? ((uint32_t)-delta << 1) - 1 : (uint32_t)delta << 1);
+    writeVarint(positions, token->length);
+    writePositionByte(positions, token->type);
+
+    positions->lastOffset = offset;
+    positions->lastStart = start;
+    positions->lastLength = token->length;
+}
+
+// decodes the token of a byte (runs are walked from the start as it's only needed for errors)
+Token getTokenAt(Chunk *chunk, int offset)
+{
+    PositionTable *positions = &chunk->positions;
+    uint8_t *current = positions->bytes;
+    uint8_t *end = positions->bytes + positions->count;
+    int runOffset = 0, start = 0;
+
+    Token token;
+    token.type = TOKEN_EOF;
+    token.source = chunk->source;
+    token.start = chunk->source;
+    token.length = 0;
+    token.errorMsg = NULL;
+
+    while (current < end)
+    {
+        runOffset += readVarint(&current);
+
+        if (runOffset > offset)
+            break;
+
+        uint32_t delta = readVarint(&current);
+        start += delta & 1 ? -(int)((delta + 1) >> 1) : (int)(delta >> 1);
+
+        token.start = chunk->source + start;
+        token.length = readVarint(&current);
+        token.type = *current++;
+    }
+
+    return token;
 }
 
 void initValueArr(ValueArr *valueArr)
@@ -30,17 +113,14 @@ void initValueArr(ValueArr *valueArr)
 
 static void writeValueArr(ValueArr *valueArr, Value value)
 {
-    push(value); //? because in the next line chunk may grow up
-
     if (valueArr->count == valueArr->capacity)
     {
         size_t oldCapacity = valueArr->capacity;
         valueArr->capacity = GROW_CAPACITY(valueArr->capacity);
-        valueArr->values = GROW_ARRAY(Value, valueArr->values, oldCapacity, valueArr->capacity);
+        valueArr->values = GROW_ARENA_ARRAY(Value, valueArr->values, oldCapacity, valueArr->capacity);
     }
 
     valueArr->values[valueArr->count++] = value;
-    pop();
 }
 
 void initChunk(Chunk *chunk)
@@ -53,11 +133,9 @@ void initChunk(Chunk *chunk)
     initValueArr(&constants);
 
     chunk->constants = constants;
+    chunk->source = NULL;
 
-    TokenArr tokenArr;
-    initTokenArr(&tokenArr);
-
-    chunk->tokenArr = tokenArr;
+    initPositionTable(&chunk->positions);
 }
 
 void writeChunk(Chunk *chunk, uint8_t byte, Token *token)
@@ -66,11 +144,14 @@ void writeChunk(Chunk *chunk, uint8_t byte, Token *token)
     {
         size_t oldCapacity = chunk->capacity;
         chunk->capacity = GROW_CAPACITY(chunk->capacity);
-        chunk->code = GROW_ARRAY(uint8_t, chunk->code, oldCapacity, chunk->capacity);
+        chunk->code = GROW_ARENA_ARRAY(uint8_t, chunk->code, oldCapacity, chunk->capacity);
     }
 
+    if (chunk->source == NULL)
+        chunk->source = token->source;
+
+    writePosition(chunk, chunk->count, token);
     chunk->code[chunk->count++] = byte;
-    writeTokenArr(&chunk->tokenArr, token);
 }
 
 uint8_t addConstant(Chunk *chunk, Value value)
@@ -80,3 +161,28 @@ uint8_t addConstant(Chunk *chunk, Value value)
 
     return chunk->constants.count - 1;
 }
+
+// moves a chunk out of the compiler's arena into right-sized arrays owned by the GC
+void finalizeChunk(Chunk *chunk)
+{
+    uint8_t *code = ALLOCATE(uint8_t, chunk->count);
+    if (chunk->count > 0)
+        memcpy(code, chunk->code, sizeof(uint8_t) * chunk->count);
+    chunk->code = code;
+    chunk->capacity = chunk->count;
+
+    PositionTable *positions = &chunk->positions;
+    uint8_t *bytes = ALLOCATE(uint8_t, positions->count);
+    if (positions->count > 0)
+        memcpy(bytes, positions->bytes, sizeof(uint8_t) * positions->count);
+    positions->bytes = bytes;
+    positions->capacity = positions->count;
+
+    // the old constants stay reachable through the arena until the swap
+    ValueArr *constants = &chunk->constants;
+    Value *values = ALLOCATE(Value, constants->count);
+    if (constants->count > 0)
+        memcpy(values, constants->values, sizeof(Value) * constants->count);
+    constants->values = values;
+    constants->capacity = constants->count;
+}
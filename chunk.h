@@ -50,14 +50,32 @@ typedef enum
     OP_GET_SUPER_METHOD,
     OP_GET_SUPER_INITIALIZER,
     //<<
+    //>> for lists
+    OP_LIST,
+    OP_GET_INDEX,
+    OP_SET_INDEX,
+    //<<
 } OpCode;
 
+/*
+    Maps bytecode offsets to the tokens they were compiled from, every run of
+    bytes that share a token is stored as varints relative to the run before it:
+        * offset delta
+        * start delta (zigzag encoded)
+        * length
+        * token type (one byte)
+*/
 typedef struct
 {
     size_t count;
     size_t capacity;
-    Token *tokens;
-} TokenArr;
+    uint8_t *bytes;
+
+    // the last run (only needed while writing)
+    int lastOffset;
+    int lastStart;
+    int lastLength;
+} PositionTable;
 
 typedef struct
 {
@@ -72,12 +90,13 @@ typedef struct
     size_t capacity;
     uint8_t *code;
     ValueArr constants;
-    TokenArr tokenArr;
+    char *source;
+    PositionTable positions;
 } Chunk;
 
 void initChunk(Chunk *);
 
-void initTokenArr(TokenArr *);
+void initPositionTable(PositionTable *);
 
 void initValueArr(ValueArr *);
 
@@ -85,4 +104,8 @@ void writeChunk(Chunk *, uint8_t, Token *);
 
 uint8_t addConstant(Chunk *, Value);
 
+void finalizeChunk(Chunk *);
+
+Token getTokenAt(Chunk *, int);
+
 #endif
\ No newline at end of file
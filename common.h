@@ -6,6 +6,8 @@
 // #define DEBUG_BYTECODE
 // #define DEBUG_WRAPPERS
 // #define STRESS_TEST_GC
+// #define SWISS_HASHMAP
+// #define FIXED_HASH_SEED
 
 #include <stdio.h>
 #include <stddef.h>
@@ -4,6 +4,7 @@
 #include "object.h"
 #include "debug.h"
 #include "vm.h"
+#include "number.h"
 
 static void errorAt(Token *, char[]);
 
@@ -62,6 +63,8 @@ static int resolveUpValue(Compiler *, Token *);
 
 static int args(void);
 
+static int items(void);
+
 static int params(void);
 
 static void expression(int);
@@ -165,7 +168,7 @@ static void emitConstant(Value value, Token *token)
 
 static void emitNumber(char *s, Token *token)
 {
-    double value = strtod(s, NULL);
+    double value = parseNumber(s, token->length);
 
     emitByte(OP_CONSTANT, token);
     emitConstant(NUMBER(value), token);
@@ -175,21 +178,15 @@ static void emitIdentifier(char *s, int length, Token *token)
 {
     ObjString *identifier = allocateObjString(s, length);
 
-    push(OBJ(identifier)); // because in the next line chunk may call GROW_ARRAY
     emitConstant(OBJ(identifier), token);
-    pop();
 }
 
 static void emitString(char *s, int length, Token *token)
 {
     ObjString *objString = allocateObjString(s, length);
 
-    push(OBJ(objString));
-
     emitByte(OP_CONSTANT, token);
     emitConstant(OBJ(objString), token);
-
-    pop();
 }
 
 static int emitJump(OpCode type, Token *token)
@@ -204,7 +201,10 @@ static void patchJump(int index)
     int value = compiler.function->chunk.count - index;
 
     if (value > UINT8_MAX)
-        errorAt(&compiler.function->chunk.tokenArr.tokens[index], "Too many code to jump over!");
+    {
+        Token token = getTokenAt(&compiler.function->chunk, index);
+        errorAt(&token, "Too many code to jump over!");
+    }
 
     compiler.function->chunk.code[index] = value;
 }
@@ -225,8 +225,6 @@ static void emitClosure(Compiler *funCompiler, Token *token)
 
     emitConstant(OBJ((Obj *)funCompiler->function), token);
 
-    pop();
-
     emitByte(funCompiler->currentUpValue, token);
 
     for (int i = 0; i < funCompiler->currentUpValue; i++)
@@ -308,6 +306,7 @@ static void getInfixBP(int bp[2], TokenType type)
         bp[0] = 18;
         break;
     case TOKEN_DOT:
+    case TOKEN_LEFT_BRACKET:
         bp[0] = 18;
         break;
     default:;
@@ -350,6 +349,7 @@ static void initCompiler(Scanner *scanner, FunctionType type, ClassType classTyp
     compiler.canAssign = true;
     compiler.inFunGrouping = false;
     compiler.groupingDepth = 0;
+    compiler.bracketDepth = 0;
     compiler.stringDepth = 0;
     compiler.scopeDepth = 0;
     compiler.ternaryDepth = 0;
@@ -552,6 +552,36 @@ static int args()
     return count;
 }
 
+// the items of a list literal, after its '['
+static int items()
+{
+    int count = 0;
+    bool prevInFunGrouping = compiler.inFunGrouping;
+    compiler.inFunGrouping = true;
+    compiler.bracketDepth++;
+
+    if (!match(TOKEN_RIGHT_BRACKET))
+    {
+        expression(0);
+        count++;
+
+        while (match(TOKEN_COMMA))
+        {
+            if (count == UINT8_MAX)
+                softErrorAt(&compiler.previous, "Can't have more than 255 items in a list literal");
+
+            expression(0);
+            count++;
+        }
+
+        consume(TOKEN_RIGHT_BRACKET, "Expected ']' after the items");
+    }
+
+    compiler.bracketDepth--;
+    compiler.inFunGrouping = prevInFunGrouping;
+    return count;
+}
+
 static int params()
 {
     int count = 0;
@@ -654,6 +684,14 @@ static void expression(int minBP)
         compiler.canAssign = false;
         emitNumber(token.start, &token);
         break;
+    case TOKEN_LEFT_BRACKET:
+    {
+        int count = items();
+
+        compiler.canAssign = false;
+        emitBytes(OP_LIST, count, &token);
+        break;
+    }
     case TOKEN_STRING:
         compiler.canAssign = false;
         emitString(token.start + 1, token.length - 2, &token);
@@ -772,6 +810,14 @@ static void expression(int minBP)
                 errorAt(&operator, "This parenthese doesn't terminate a group");
         }
 
+        if (operator.type == TOKEN_RIGHT_BRACKET)
+        {
+            if (compiler.bracketDepth)
+                break;
+            else
+                errorAt(&operator, "This bracket doesn't close anything");
+        }
+
         if (operator.type == TOKEN_COLON)
         {
             if (compiler.ternaryDepth)
@@ -805,6 +851,7 @@ static void expression(int minBP)
         case TOKEN_OR:
         case TOKEN_QUESTION_MARK:
         case TOKEN_LEFT_PAREN:
+        case TOKEN_LEFT_BRACKET:
         case TOKEN_DOT:
             opCode = -1;
             break;
@@ -842,7 +889,9 @@ static void expression(int minBP)
             errorAt(&operator, "Unexpected token");
         }
 
-        if (operator.type != TOKEN_DOT)
+        bool canAssign = compiler.canAssign;
+
+        if (operator.type != TOKEN_DOT && operator.type != TOKEN_LEFT_BRACKET)
             compiler.canAssign = false;
 
         int bp[2];
@@ -969,6 +1018,41 @@ static void expression(int minBP)
                 }
                 else
                     emitBytes(OP_GET_PROPERTY, keyConstant, &keyToken);
+
+                break;
+            }
+            case TOKEN_LEFT_BRACKET:
+            {
+                bool prevInFunGrouping = compiler.inFunGrouping;
+                compiler.inFunGrouping = false;
+                compiler.bracketDepth++;
+
+                expression(0);
+                consume(TOKEN_RIGHT_BRACKET, "Expected ']' after the index");
+
+                compiler.bracketDepth--;
+                compiler.inFunGrouping = prevInFunGrouping;
+
+                // the index doesn't decide whether the indexed expression is assignable
+                compiler.canAssign = canAssign;
+
+                if (check(TOKEN_EQUAL))
+                {
+                    if (compiler.canAssign)
+                    {
+                        advance();
+                        int bp[2];
+                        getInfixBP(bp, TOKEN_EQUAL);
+                        expression(bp[1]);
+                        emitByte(OP_SET_INDEX, &operator);
+                    }
+                    else
+                        errorAt(&compiler.current, "Bad assignment target");
+                }
+                else
+                    emitByte(OP_GET_INDEX, &operator);
+
+                break;
             }
             default:;
             }
@@ -1031,18 +1115,22 @@ static void ifStatement()
     compiler.groupingDepth--;
 
     int elseJumpIndex = emitJump(OP_JUMP_IF_FALSE, &token);
+    emitByte(OP_POP, &token); // if the condition was true
 
     statement();
 
     int ifJumpIndex = emitJump(OP_JUMP, &token);
 
     patchJump(elseJumpIndex);
+    emitByte(OP_POP, &token); // if it was false
 
     if (match(TOKEN_ELSE))
     {
+        compiler.canAssign = true;
         statement();
-        patchJump(ifJumpIndex);
     }
+
+    patchJump(ifJumpIndex);
 }
 
 static void whileStatement()
@@ -1191,7 +1279,7 @@ static void varDeclaration()
     defineVariable(&token, &name);
 }
 
-// The function that the compiler parses gets pushed to the stack so don't forget to pop it!
+// The returned function isn't rooted anymore so it should be emitted right away
 // The first token can be an identifier or a left parenthese
 static Compiler fun(FunctionType type, ClassType classType)
 {
@@ -1232,9 +1320,9 @@ static Compiler fun(FunctionType type, ClassType classType)
         disassembleChunk(&compiler.function->chunk, compiler.function->name ? compiler.function->name->chars : NULL);
 #endif
 
-    funCompiler = compiler;
+    finalizeChunk(&compiler.function->chunk);
 
-    push(OBJ(funCompiler.function));
+    funCompiler = compiler;
 
     enclosingCompiler.previous = compiler.previous;
     enclosingCompiler.current = compiler.current;
@@ -1380,6 +1468,9 @@ ObjFunction *compile(Scanner *scanner)
 
     emitReturn(&compiler.current);
 
+    finalizeChunk(&compiler.function->chunk);
+    resetArena(&vm.arena);
+
     if (compiler.hadError)
         return NULL;
 
@@ -52,6 +52,7 @@ typedef struct Compiler
     bool canAssign;
     bool inFunGrouping;
     int groupingDepth;
+    int bracketDepth;
     int stringDepth;
     int scopeDepth;
     int ternaryDepth;
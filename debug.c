@@ -83,6 +83,12 @@ char *opCodeToString(OpCode opCode)
         return "GET_SUPER_METHOD";
     case OP_GET_SUPER_INITIALIZER:
         return "GET_SUPER_INITIALIZER";
+    case OP_LIST:
+        return "LIST";
+    case OP_GET_INDEX:
+        return "GET_INDEX";
+    case OP_SET_INDEX:
+        return "SET_INDEX";
     default:;
     }
 }
@@ -153,7 +159,7 @@ int invokeInstruction(Chunk *chunk, int offset)
 int disassembleInstruction(Chunk *chunk, int offset)
 {
     OpCode opCode = chunk->code[offset];
-    Token token = chunk->tokenArr.tokens[offset];
+    Token token = getTokenAt(chunk, offset);
 
     int pos[2];
     getTokenPos(pos, &token);
@@ -181,6 +187,8 @@ int disassembleInstruction(Chunk *chunk, int offset)
     case OP_INHERIT:
     case OP_INITIALIZER:
     case OP_GET_SUPER_INITIALIZER:
+    case OP_GET_INDEX:
+    case OP_SET_INDEX:
         return noOperands(chunk, offset);
     case OP_GET_GLOBAL:
     case OP_DEFINE_GLOBAL:
@@ -201,6 +209,7 @@ int disassembleInstruction(Chunk *chunk, int offset)
     case OP_CALL:
     case OP_GET_UPVALUE:
     case OP_SET_UPVALUE:
+    case OP_LIST:
         return u8Operand(chunk, offset);
     case OP_CLOSURE:
         return closureInstruction(chunk, offset);
@@ -237,6 +246,12 @@ char *tokenTypeToString(TokenType type)
     case TOKEN_RIGHT_BRACE:
         return "RIGHT_BRACE";
         break;
+    case TOKEN_LEFT_BRACKET:
+        return "LEFT_BRACKET";
+        break;
+    case TOKEN_RIGHT_BRACKET:
+        return "RIGHT_BRACKET";
+        break;
     case TOKEN_COMMA:
         return "COMMA";
         break;
@@ -0,0 +1,193 @@
+#include "file.h"
+#include "memory.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//> HELPERS
+// releases the descriptor and the buffer, closing twice does nothing
+void closeFile(ObjFile *file)
+{
+    if (file->fd == -1)
+        return;
+
+    close(file->fd);
+    FREE_ARRAY(char, file->buffer, file->capacity);
+
+    file->fd = -1;
+    file->buffer = NULL;
+    file->capacity = file->start = file->end = 0;
+}
+
+// moves the unconsumed bytes to the start of the buffer and reads after them,
+// the buffer only grows when a single line fills it, returns false at the end
+// of the file (read errors count as the end too)
+static bool fillBuffer(ObjFile *file)
+{
+    size_t unread = file->end - file->start;
+
+    memmove(file->buffer, file->buffer + file->start, unread);
+    file->start = 0;
+    file->end = unread;
+
+    if (file->end == file->capacity)
+    {
+        size_t capacity = file->capacity * 2;
+
+        file->buffer = GROW_ARRAY(char, file->buffer, file->capacity, capacity);
+        file->capacity = capacity;
+    }
+
+    ssize_t count = read(file->fd, file->buffer + file->end, file->capacity - file->end);
+
+    if (count <= 0)
+        return false;
+
+    file->end += count;
+    return true;
+}
+
+// the line is copied straight from the buffer into its string, a "\r" before
+// the "\n" is dropped too
+static ObjString *takeLine(ObjFile *file, size_t length, size_t consumed)
+{
+    char *chars = file->buffer + file->start;
+
+    file->start += consumed;
+
+    if (length > 0 && chars[length - 1] == '\r')
+        length--;
+
+    return allocateUninternedObjString(chars, length);
+}
+
+// returns the next line without its line break or NULL at the end of the file,
+// the search for the "\n" picks up where it stopped before the buffer got refilled
+static ObjString *nextLine(ObjFile *file)
+{
+    size_t searched = 0;
+
+    while (true)
+    {
+        char *line = file->buffer + file->start;
+        size_t unread = file->end - file->start;
+        char *newline = memchr(line + searched, '\n', unread - searched);
+
+        if (newline != NULL)
+            return takeLine(file, newline - line, newline - line + 1);
+
+        searched = unread;
+
+        if (!fillBuffer(file))
+            break;
+    }
+
+    // the last line doesn't have to end with a "\n"
+    if (file->start == file->end)
+        return NULL;
+
+    return takeLine(file, file->end - file->start, file->end - file->start);
+}
+
+static bool checkOpen(ObjFile *file)
+{
+    if (file->fd == -1)
+    {
+        runtimeError("The file is closed");
+        return false;
+    }
+
+    return true;
+}
+//<
+
+//> NATIVE FUNCTIONS
+// opens a file for reading
+bool nativeOpen(Value *returnValue, Value *args)
+{
+    if (!IS_STRING(args[1]))
+    {
+        runtimeError("The path should be a string");
+        return false;
+    }
+
+    ObjString *path = AS_STRING(args[1]);
+
+    // a collection could compact the path (if it's a view) under our feet
+    vm.deferGc++;
+
+    // views aren't null terminated
+    char *terminated = ALLOCATE(char, path->length + 1);
+    memcpy(terminated, flattenString(path), path->length);
+    terminated[path->length] = '\0';
+
+    int fd = open(terminated, O_RDONLY);
+
+    FREE_ARRAY(char, terminated, path->length + 1);
+    vm.deferGc--;
+
+    if (fd == -1)
+    {
+        runtimeError("Couldn't open the file");
+        return false;
+    }
+
+    *returnValue = OBJ(allocateObjFile(fd));
+    return true;
+}
+//<
+
+//> METHODS
+// nil at the end of the file
+static bool fileReadLine(Value *returnValue, Value *args)
+{
+    ObjFile *file = AS_FILE(args[0]);
+
+    if (!checkOpen(file))
+        return false;
+
+    ObjString *line = nextLine(file);
+
+    *returnValue = line == NULL ? NIL : OBJ(line);
+    return true;
+}
+
+// calls the function with every line that's left, only one line is kept in
+// memory at a time, it stops early if the function closes the file
+static bool fileLines(Value *returnValue, Value *args)
+{
+    ObjFile *file = AS_FILE(args[0]);
+    ObjString *line;
+    Value ignored;
+
+    if (!checkOpen(file))
+        return false;
+
+    while (file->fd != -1 && (line = nextLine(file)) != NULL)
+    {
+        Value arg = OBJ(line);
+
+        if (!vmCallValue(args[1], 1, &arg, &ignored))
+            return false;
+    }
+
+    *returnValue = NIL;
+    return true;
+}
+
+static bool fileClose(Value *returnValue, Value *args)
+{
+    closeFile(AS_FILE(args[0]));
+
+    *returnValue = NIL;
+    return true;
+}
+
+NativeDef fileMethods[] = {
+    {"readLine", (NativeFun)fileReadLine, 0, 0},
+    {"lines", (NativeFun)fileLines, 1, 1},
+    {"close", (NativeFun)fileClose, 0, 0},
+};
+
+int fileMethodsCount = sizeof(fileMethods) / sizeof(NativeDef);
+//<
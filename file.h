@@ -0,0 +1,16 @@
+#ifndef clox_file_h
+#define clox_file_h
+
+#include "common.h"
+#include "vm.h"
+
+// methods of files, they get the file they're called on in `args[0]`
+extern NativeDef fileMethods[];
+
+extern int fileMethodsCount;
+
+bool nativeOpen(Value *, Value *);
+
+void closeFile(ObjFile *);
+
+#endif
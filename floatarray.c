@@ -0,0 +1,107 @@
+#include "floatarray.h"
+#include "simd.h"
+
+//> HELPERS
+static bool sameLength(ObjFloatArray *array, Value other)
+{
+    if (!IS_FLOAT_ARRAY(other))
+    {
+        runtimeError("The argument should be a float array");
+        return false;
+    }
+
+    if (AS_FLOAT_ARRAY(other)->length != array->length)
+    {
+        runtimeError("The arrays should have the same length");
+        return false;
+    }
+
+    return true;
+}
+//<
+
+//> METHODS
+static bool floatArraySum(Value *returnValue, Value *args)
+{
+    ObjFloatArray *array = AS_FLOAT_ARRAY(args[0]);
+
+    *returnValue = NUMBER(sumDoubles(array->values, array->length));
+    return true;
+}
+
+// nil for an empty array
+static bool floatArrayMin(Value *returnValue, Value *args)
+{
+    ObjFloatArray *array = AS_FLOAT_ARRAY(args[0]);
+
+    *returnValue = array->length == 0 ? NIL : NUMBER(minDoubles(array->values, array->length));
+    return true;
+}
+
+static bool floatArrayMax(Value *returnValue, Value *args)
+{
+    ObjFloatArray *array = AS_FLOAT_ARRAY(args[0]);
+
+    *returnValue = array->length == 0 ? NIL : NUMBER(maxDoubles(array->values, array->length));
+    return true;
+}
+
+static bool floatArrayDot(Value *returnValue, Value *args)
+{
+    ObjFloatArray *array = AS_FLOAT_ARRAY(args[0]);
+
+    if (!sameLength(array, args[1]))
+        return false;
+
+    *returnValue = NUMBER(dotDoubles(array->values, AS_FLOAT_ARRAY(args[1])->values, array->length));
+    return true;
+}
+
+// multiplies in place and returns the array so calls can be chained
+static bool floatArrayScale(Value *returnValue, Value *args)
+{
+    ObjFloatArray *array = AS_FLOAT_ARRAY(args[0]);
+
+    if (!IS_NUMBER(args[1]))
+    {
+        runtimeError("The factor should be a number");
+        return false;
+    }
+
+    scaleDoubles(array->values, array->length, AS_NUMBER(args[1]));
+
+    *returnValue = args[0];
+    return true;
+}
+
+// `y.axpy(a, x)` does y = a * x + y in place and returns y
+static bool floatArrayAxpy(Value *returnValue, Value *args)
+{
+    ObjFloatArray *array = AS_FLOAT_ARRAY(args[0]);
+
+    if (!IS_NUMBER(args[1]))
+    {
+        runtimeError("The factor should be a number");
+        return false;
+    }
+
+    if (!sameLength(array, args[2]))
+        return false;
+
+    axpyDoubles(array->values, AS_FLOAT_ARRAY(args[2])->values, array->length, AS_NUMBER(args[1]));
+
+    *returnValue = args[0];
+    return true;
+}
+
+NativeDef floatArrayMethods[] = {
+    {"sum", (NativeFun)floatArraySum, 0, 0},
+    {"min", (NativeFun)floatArrayMin, 0, 0},
+    {"max", (NativeFun)floatArrayMax, 0, 0},
+    {"dot", (NativeFun)floatArrayDot, 1, 1},
+    {"scale", (NativeFun)floatArrayScale, 1, 1},
+    {"axpy", (NativeFun)floatArrayAxpy, 2, 2},
+};
+
+int floatArrayMethodsCount = sizeof(floatArrayMethods) / sizeof(NativeDef);
+//<
@@ -0,0 +1,12 @@
+#ifndef clox_floatarray_h
+#define clox_floatarray_h
+
+#include "common.h"
+#include "vm.h"
+
+// methods of float arrays, they get the array they're called on in `args[0]`
+extern NativeDef floatArrayMethods[];
+
+extern int floatArrayMethodsCount;
+
+#endif
@@ -5,29 +5,422 @@
 #include <string.h>
 #include <stdio.h>
 
-uint32_t hashString(char key[], int length)
+#if defined(SWISS_HASHMAP) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//> HASHING
+// wyhash's secrets
+#define SECRET0 0xa0761d6478bd642full
+#define SECRET1 0xe7037ed1a0b428dbull
+#define SECRET2 0x8ebc6af09c88c6e3ull
+#define SECRET3 0x589965cc75374cc3ull
+
+// the xor of the two halves of the 128 bit product
+static uint64_t mix(uint64_t a, uint64_t b)
 {
-    uint32_t hash = 2166136261u;
+#ifdef __SIZEOF_INT128__
+    __uint128_t product = (__uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+#else
+    uint64_t aHigh = a >> 32, aLow = (uint32_t)a, bHigh = b >> 32, bLow = (uint32_t)b;
+    uint64_t high = aHigh * bHigh, middle0 = aHigh * bLow, middle1 = aLow * bHigh, low = aLow * bLow;
+    uint64_t carry = ((low >> 32) + (uint32_t)middle0 + (uint32_t)middle1) >> 32;
+
+    return (low + (middle0 << 32) + (middle1 << 32)) ^ (high + (middle0 >> 32) + (middle1 >> 32) + carry);
+#endif
+}
 
-    int i = 0;
+static uint64_t read64(uint8_t *bytes)
+{
+    uint64_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+// one multiply per byte, which is still the fastest for identifiers
+static uint32_t fnv1a(uint8_t *bytes, size_t length)
+{
+    uint32_t hash = 2166136261u ^ (uint32_t)vm.hashSeed;
 
-    while (i < length)
+    for (size_t i = 0; i < length; i++)
     {
-        hash ^= (uint8_t)key[i];
+        hash ^= bytes[i];
         hash *= 16777619;
-        i++;
     }
 
     return hash;
 }
 
+// wyhash's loop, 16 or 48 bytes per step (needs at least 16 bytes)
+static uint32_t wyhash(uint8_t *bytes, size_t length)
+{
+    uint64_t seed = vm.hashSeed ^ SECRET0;
+    size_t left = length;
+
+    if (left > 48)
+    {
+        uint64_t seed1 = seed, seed2 = seed;
+
+        do
+        {
+            seed = mix(read64(bytes) ^ SECRET1, read64(bytes + 8) ^ seed);
+            seed1 = mix(read64(bytes + 16) ^ SECRET2, read64(bytes + 24) ^ seed1);
+            seed2 = mix(read64(bytes + 32) ^ SECRET3, read64(bytes + 40) ^ seed2);
+            bytes += 48;
+            left -= 48;
+        } while (left > 48);
+
+        seed ^= seed1 ^ seed2;
+    }
+
+    while (left > 16)
+    {
+        seed = mix(read64(bytes) ^ SECRET1, read64(bytes + 8) ^ seed);
+        bytes += 16;
+        left -= 16;
+    }
+
+    // the last 16 bytes (overlapping the ones before if needed)
+    uint64_t a = read64(bytes + left - 16), b = read64(bytes + left - 8);
+
+    return (uint32_t)mix(SECRET1 ^ length, mix(a ^ SECRET1, b ^ seed));
+}
+
+// seeded per vm (see `initVm`) so scripts can't precompute colliding keys
+uint32_t hashString(char key[], int length)
+{
+    if (length < HASH_LONG_LENGTH)
+        return fnv1a((uint8_t *)key, length);
+
+    return wyhash((uint8_t *)key, length);
+}
+
+#undef SECRET0
+#undef SECRET1
+#undef SECRET2
+#undef SECRET3
+//<
+
+#ifdef SWISS_HASHMAP
+//> SWISS_HASHMAP
+#define EMPTY ((int8_t)-128)
+#define DELETED ((int8_t)-2)
+
+// the low 7 bits of the hash go to the control byte, the rest pick the group
+#define H1(hash) ((hash) >> 7)
+#define H2(hash) ((int8_t)((hash)&0x7f))
+
+void initHashMap(HashMap *hashMap)
+{
+    hashMap->capacity = 0;
+    hashMap->count = 0;
+    hashMap->tombstones = 0;
+    hashMap->controls = NULL;
+    hashMap->entries = NULL;
+}
+
+// entries and control bytes share a single allocation (entries first)
+static size_t tableSize(int capacity)
+{
+    return (sizeof(Entry) + sizeof(int8_t)) * capacity;
+}
+
+void freeHashMap(HashMap *hashMap)
+{
+    FREE_ARRAY(uint8_t, hashMap->entries, tableSize(hashMap->capacity));
+
+    initHashMap(hashMap);
+}
+
+// each bit of the masks stands for a slot of the group
+#ifdef __SSE2__
+static uint32_t matchByte(int8_t *group, int8_t byte)
+{
+    __m128i controls = _mm_loadu_si128((__m128i *)group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(controls, _mm_set1_epi8(byte)));
+}
+
+static uint32_t matchEmptyOrDeleted(int8_t *group)
+{
+    // only these two have the high bit set
+    return _mm_movemask_epi8(_mm_loadu_si128((__m128i *)group));
+}
+#else
+static uint32_t matchByte(int8_t *group, int8_t byte)
+{
+    uint32_t mask = 0;
+
+    for (int i = 0; i < GROUP_WIDTH; i++)
+        if (group[i] == byte)
+            mask |= 1u << i;
+
+    return mask;
+}
+
+static uint32_t matchEmptyOrDeleted(int8_t *group)
+{
+    uint32_t mask = 0;
+
+    for (int i = 0; i < GROUP_WIDTH; i++)
+        if (group[i] < 0)
+            mask |= 1u << i;
+
+    return mask;
+}
+#endif
+
+static int lowestBit(uint32_t mask)
+{
+    return __builtin_ctz(mask);
+}
+
+// returns the entry of the key or NULL
+static Entry *findEntry(HashMap *hashMap, struct ObjString *key)
+{
+    if (hashMap->capacity == 0)
+        return NULL;
+
+    int groups = hashMap->capacity / GROUP_WIDTH;
+    int group = H1(key->hash) & (groups - 1);
+
+    for (int probe = 0; probe < groups; probe++)
+    {
+        int8_t *controls = &hashMap->controls[group * GROUP_WIDTH];
+
+        for (uint32_t matches = matchByte(controls, H2(key->hash)); matches != 0; matches &= matches - 1)
+        {
+            Entry *entry = &hashMap->entries[group * GROUP_WIDTH + lowestBit(matches)];
+
+            if (entry->key == key)
+                return entry;
+        }
+
+        // keys never get placed past a group that has an empty slot
+        if (matchByte(controls, EMPTY) != 0)
+            return NULL;
+
+        group = (group + 1) & (groups - 1);
+    }
+
+    return NULL;
+}
+
+// returns the index of the first empty or deleted slot of the probe sequence
+static int findFreeSlot(HashMap *hashMap, uint32_t hash)
+{
+    int groups = hashMap->capacity / GROUP_WIDTH;
+    int group = H1(hash) & (groups - 1);
+
+    while (true)
+    {
+        uint32_t matches = matchEmptyOrDeleted(&hashMap->controls[group * GROUP_WIDTH]);
+
+        if (matches != 0)
+            return group * GROUP_WIDTH + lowestBit(matches);
+
+        group = (group + 1) & (groups - 1);
+    }
+}
+
+static void place(HashMap *hashMap, struct ObjString *key, Value value)
+{
+    int index = findFreeSlot(hashMap, key->hash);
+
+    if (hashMap->controls[index] == DELETED)
+        hashMap->tombstones--;
+
+    hashMap->controls[index] = H2(key->hash);
+    hashMap->entries[index].key = key;
+    hashMap->entries[index].value = value;
+    hashMap->count++;
+}
+
+static int capacityFor(int count)
+{
+    int capacity = GROUP_WIDTH;
+
+    while (count > capacity * HASHMAP_MAX_LOAD)
+        capacity *= 2;
+
+    return capacity;
+}
+
+// rehashes the live entries into a new table, tombstones are left behind
+static void resize(HashMap *hashMap, int capacity)
+{
+    HashMap old = *hashMap;
+
+    // callers may hold keys and values that aren't rooted, so resizing never collects
+    vm.deferGc++;
+    Entry *entries = (Entry *)ALLOCATE(uint8_t, tableSize(capacity));
+    vm.deferGc--;
+
+    hashMap->capacity = capacity;
+    hashMap->count = 0;
+    hashMap->tombstones = 0;
+    hashMap->entries = entries;
+    hashMap->controls = (int8_t *)(entries + capacity);
+
+    memset(hashMap->controls, (uint8_t)EMPTY, capacity);
+
+    int i = 0;
+    Entry *entry;
+
+    while ((entry = hashMapNext(&old, &i)) != NULL)
+        place(hashMap, entry->key, entry->value);
+
+    freeHashMap(&old);
+}
+
+// returns whether the entry was new or not
+bool hashMapInsert(HashMap *hashMap, struct ObjString *key, Value value)
+{
+    Entry *entry = findEntry(hashMap, key);
+
+    if (entry != NULL)
+    {
+        entry->value = value;
+        return false;
+    }
+
+    if (hashMap->count + hashMap->tombstones + 1 > hashMap->capacity * HASHMAP_MAX_LOAD)
+        resize(hashMap, capacityFor(hashMap->count + 1));
+
+    place(hashMap, key, value);
+
+    return true;
+}
+
+Value *hashMapGet(HashMap *hashMap, struct ObjString *key)
+{
+    Entry *entry = findEntry(hashMap, key);
+
+    if (entry == NULL)
+        return NULL;
+
+    return &entry->value;
+}
+
+// probes like `findEntry` but compares the content of the keys
+struct ObjString *findKey(HashMap *hashMap, char *keyChars, int keyLength, uint32_t keyHash)
+{
+    if (hashMap->capacity == 0)
+        return NULL;
+
+    int groups = hashMap->capacity / GROUP_WIDTH;
+    int group = H1(keyHash) & (groups - 1);
+
+    for (int probe = 0; probe < groups; probe++)
+    {
+        int8_t *controls = &hashMap->controls[group * GROUP_WIDTH];
+
+        for (uint32_t matches = matchByte(controls, H2(keyHash)); matches != 0; matches &= matches - 1)
+        {
+            struct ObjString *key = hashMap->entries[group * GROUP_WIDTH + lowestBit(matches)].key;
+
+            if (key->hash == keyHash && key->length == keyLength && memcmp(key->chars, keyChars, keyLength) == 0)
+                return key;
+        }
+
+        if (matchByte(controls, EMPTY) != 0)
+            return NULL;
+
+        group = (group + 1) & (groups - 1);
+    }
+
+    return NULL;
+}
+
+static void removeEntry(HashMap *hashMap, Entry *entry)
+{
+    int index = entry - hashMap->entries;
+    int8_t *group = &hashMap->controls[index - index % GROUP_WIDTH];
+
+    // probes already stop at a group with an empty slot, so no tombstone is needed there
+    if (matchByte(group, EMPTY) != 0)
+        hashMap->controls[index] = EMPTY;
+    else
+    {
+        hashMap->controls[index] = DELETED;
+        hashMap->tombstones++;
+    }
+
+    entry->key = NULL;
+    entry->value = NIL;
+    hashMap->count--;
+}
+
+// returns whether the entry existed or not
+bool hashMapRemove(HashMap *hashMap, struct ObjString *key)
+{
+    Entry *entry = findEntry(hashMap, key);
+
+    if (entry == NULL)
+        return false;
+
+    removeEntry(hashMap, entry);
+
+    if (hashMap->capacity > GROUP_WIDTH && hashMap->count < hashMap->capacity * HASHMAP_MIN_LOAD)
+        resize(hashMap, capacityFor(hashMap->count));
+
+    return true;
+}
+
+// removes every entry whose key isn't marked, it's used while collecting
+// garbage so it never resizes (which would allocate)
+void hashMapRemoveWhite(HashMap *hashMap)
+{
+    int i = 0;
+    Entry *entry;
+
+    while ((entry = hashMapNext(hashMap, &i)) != NULL)
+    {
+        if (entry->key->obj.marked)
+            continue;
+
+#ifdef DEBUG_STRINGS_INTERNING
+        printf("'%s' got removed from interned strings\n", entry->key->chars);
+#endif
+        removeEntry(hashMap, entry);
+    }
+}
+
+// returns the next live entry starting from `*index` (NULL once there are no more)
+Entry *hashMapNext(HashMap *hashMap, int *index)
+{
+    while (*index < hashMap->capacity)
+    {
+        int i = (*index)++;
+
+        if (hashMap->controls[i] >= 0)
+            return &hashMap->entries[i];
+    }
+
+    return NULL;
+}
+
+#undef EMPTY
+#undef DELETED
+#undef H1
+#undef H2
+//<
+#else
 void initHashMap(HashMap *hashMap)
 {
     hashMap->capacity = 0;
     hashMap->count = 0;
+    hashMap->tombstones = 0;
     hashMap->entries = NULL;
 }
 
+void freeHashMap(HashMap *hashMap)
+{
+    FREE_ARRAY(Entry, hashMap->entries, hashMap->capacity);
+
+    initHashMap(hashMap);
+}
+
 // returns a tombstone, newEntry, or existingEntry
 static Entry *findEntry(Entry *entries, int capacity, struct ObjString *key)
 {
@@ -71,107 +464,177 @@ static Entry *findEntry(Entry *entries, int capacity, struct ObjString *key)
 #undef NEXT_INDEX
 }
 
-// returns whether the entry was new or not
-bool hashMapInsert(HashMap *hashMap, struct ObjString *key, Value value)
+// the smallest capacity that holds `count` entries under the max load
+static int capacityFor(int count)
 {
-    push(OBJ(key));
-    push(value);
+    int capacity = GROW_CAPACITY(0);
 
-    if (hashMap->count == hashMap->capacity)
-    {
-        int capacity = GROW_CAPACITY(hashMap->capacity);
-        Entry *entries = ALLOCATE(Entry, capacity);
+    while (count > capacity * HASHMAP_MAX_LOAD)
+        capacity = GROW_CAPACITY(capacity);
 
-        // clear the new one
-        for (int i = 0; i < capacity; i++)
-        {
-            entries[i].key = NULL;
-            entries[i].isTombstone = false;
-            entries[i].value = NIL;
-        }
+    return capacity;
+}
 
-        // transfer the content of the old to it
-        for (int i = 0; i < hashMap->capacity; i++)
-        {
-            Entry *oldEntry = &hashMap->entries[i];
+// rehashes the live entries into a new table, tombstones are left behind
+static void resize(HashMap *hashMap, int capacity)
+{
+    // callers may hold keys and values that aren't rooted, so resizing never collects
+    vm.deferGc++;
+    Entry *entries = ALLOCATE(Entry, capacity);
+    vm.deferGc--;
 
-            if (oldEntry->key != NULL)
-            {
-                Entry *entry = findEntry(entries, capacity, oldEntry->key);
+    // clear the new one
+    for (int i = 0; i < capacity; i++)
+    {
+        entries[i].key = NULL;
+        entries[i].isTombstone = false;
+        entries[i].value = NIL;
+    }
 
-                entry->key = oldEntry->key;
-                entry->value = oldEntry->value;
-                entry->isTombstone = oldEntry->isTombstone;
-            }
-        }
+    // transfer the live entries of the old to it
+    for (int i = 0; i < hashMap->capacity; i++)
+    {
+        Entry *oldEntry = &hashMap->entries[i];
+
+        if (oldEntry->key == NULL || oldEntry->isTombstone)
+            continue;
 
-        // free the old one
-        FREE_ARRAY(Entry, hashMap->entries, hashMap->capacity);
+        Entry *entry = findEntry(entries, capacity, oldEntry->key);
 
-        hashMap->capacity = capacity;
-        hashMap->entries = entries;
+        entry->key = oldEntry->key;
+        entry->value = oldEntry->value;
     }
 
+    // free the old one
+    FREE_ARRAY(Entry, hashMap->entries, hashMap->capacity);
+
+    hashMap->capacity = capacity;
+    hashMap->entries = entries;
+    hashMap->tombstones = 0;
+}
+
+// returns whether the entry was new or not
+bool hashMapInsert(HashMap *hashMap, struct ObjString *key, Value value)
+{
+    if (hashMap->count + hashMap->tombstones + 1 > hashMap->capacity * HASHMAP_MAX_LOAD)
+        resize(hashMap, capacityFor(hashMap->count + 1));
+
     Entry *entry = findEntry(hashMap->entries, hashMap->capacity, key);
-    bool isNew = entry->key == NULL;
+    bool isNew = entry->key == NULL || entry->isTombstone;
 
-    entry->key = key;
-    entry->value = value;
+    if (entry->isTombstone)
+        hashMap->tombstones--;
 
-    hashMap->count++;
+    if (isNew)
+        hashMap->count++;
 
-    pop();
-    pop();
+    entry->key = key;
+    entry->value = value;
+    entry->isTombstone = false;
 
     return isNew;
 }
 
-void hashMapInsertAll(HashMap *target, HashMap *source)
-{
-    for (int i = 0; i < source->capacity; i++)
-    {
-        Entry *entry = &source->entries[i];
-        if (entry->key != NULL && !entry->isTombstone)
-            hashMapInsert(target, entry->key, entry->value);
-    }
-}
-
 Value *hashMapGet(HashMap *hashMap, struct ObjString *key)
 {
     Entry *entry = findEntry(hashMap->entries, hashMap->capacity, key);
 
-    if (entry->key != key)
+    if (entry == NULL || entry->key != key || entry->isTombstone)
         return NULL;
 
     return &entry->value;
 }
 
+// probes like `findEntry` but compares the content of the keys
 struct ObjString *findKey(HashMap *hashMap, char *keyChars, int keyLength, uint32_t keyHash)
 {
-    for (int i = 0; i < hashMap->capacity; i++)
+    if (hashMap->capacity == 0)
+        return NULL;
+
+    int index = keyHash & (hashMap->capacity - 1);
+
+    while (true)
     {
-        Entry *entry = &hashMap->entries[i];
+        Entry *entry = &hashMap->entries[index];
+
+        if (entry->key == NULL)
+            return NULL;
 
-        if (entry->key != NULL && !entry->isTombstone && entry->key->hash == keyHash && entry->key->length == keyLength && strncmp(entry->key->chars, keyChars, keyLength) == 0)
+        if (!entry->isTombstone && entry->key->hash == keyHash && entry->key->length == keyLength && memcmp(entry->key->chars, keyChars, keyLength) == 0)
             return entry->key;
+
+        index = (index + 1) & (hashMap->capacity - 1);
     }
+}
 
-    return NULL;
+// turns the entry to a tombstone, returns whether it was live or not
+static bool removeEntry(HashMap *hashMap, Entry *entry)
+{
+    if (entry == NULL || entry->key == NULL || entry->isTombstone)
+        return false;
+
+    entry->isTombstone = true;
+    entry->value = NIL;
+    hashMap->count--;
+    hashMap->tombstones++;
+
+    return true;
 }
 
 // returns whether the entry existed or not
 bool hashMapRemove(HashMap *hashMap, struct ObjString *key)
 {
-    // find the key
     Entry *entry = findEntry(hashMap->entries, hashMap->capacity, key);
 
-    // turn it to a tombstone
-    if (entry->key != NULL)
+    if (entry == NULL || entry->key != key || !removeEntry(hashMap, entry))
+        return false;
+
+    int minCapacity = GROW_CAPACITY(0);
+
+    if (hashMap->capacity > minCapacity && hashMap->count < hashMap->capacity * HASHMAP_MIN_LOAD)
+        resize(hashMap, capacityFor(hashMap->count));
+
+    return true;
+}
+
+// removes every entry whose key isn't marked, it's used while collecting
+// garbage so it never resizes (which would allocate)
+void hashMapRemoveWhite(HashMap *hashMap)
+{
+    for (int i = 0; i < hashMap->capacity; i++)
     {
-        hashMap->count--;
-        entry->isTombstone = true;
-        return true;
+        Entry *entry = &hashMap->entries[i];
+
+        if (entry->key == NULL || entry->isTombstone || entry->key->obj.marked)
+            continue;
+
+#ifdef DEBUG_STRINGS_INTERNING
+        printf("'%s' got removed from interned strings\n", entry->key->chars);
+#endif
+        removeEntry(hashMap, entry);
     }
+}
+
+// returns the next live entry starting from `*index` (NULL once there are no more)
+Entry *hashMapNext(HashMap *hashMap, int *index)
+{
+    while (*index < hashMap->capacity)
+    {
+        Entry *entry = &hashMap->entries[(*index)++];
+
+        if (entry->key != NULL && !entry->isTombstone)
+            return entry;
+    }
+
+    return NULL;
+}
+#endif
+
+void hashMapInsertAll(HashMap *target, HashMap *source)
+{
+    int i = 0;
+    Entry *entry;
 
-    return false;
+    while ((entry = hashMapNext(source, &i)) != NULL)
+        hashMapInsert(target, entry->key, entry->value);
 }
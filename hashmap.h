@@ -5,24 +5,52 @@
 #include "value.h"
 
 struct ObjString;
+
+#ifdef SWISS_HASHMAP
+// slots are probed a group at a time
+#define GROUP_WIDTH 16
+
+typedef struct
+{
+    struct ObjString *key;
+    Value value;
+} Entry;
+#else
 typedef struct
 {
     struct ObjString *key;
     Value value;
     bool isTombstone;
 } Entry;
+#endif
+
+// tables are grown (or cleaned of tombstones) once entries and tombstones pass
+// the max load, and shrunk once removals leave them under the min one
+#define HASHMAP_MAX_LOAD 0.75
+#define HASHMAP_MIN_LOAD 0.25
 
 typedef struct
 {
     int capacity;
-    int count;
+    int count; // live entries only
+    int tombstones;
+#ifdef SWISS_HASHMAP
+    // a byte per slot, it's either empty, deleted, or holds 7 bits of the key's hash
+    int8_t *controls;
+#endif
     Entry *entries;
 } HashMap;
 
+// strings at least this long are hashed 16 bytes at a time instead of one
+#define HASH_LONG_LENGTH 16
+
 uint32_t hashString(char[], int);
 
 void initHashMap(HashMap *);
 
+void freeHashMap(HashMap *);
+
+// keys are compared by identity so they have to be interned strings
 bool hashMapInsert(HashMap *, struct ObjString *, Value);
 
 void hashMapInsertAll(HashMap *, HashMap *);
@@ -33,4 +61,8 @@ struct ObjString *findKey(HashMap *, char *, int, uint32_t);
 
 bool hashMapRemove(HashMap *, struct ObjString *);
 
+void hashMapRemoveWhite(HashMap *);
+
+Entry *hashMapNext(HashMap *, int *);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,445 @@
+#include "list.h"
+#include "memory.h"
+#include <math.h>
+#include <string.h>
+
+//> HELPERS
+// grows the items by doubling so appending is amortized O(1), the value is kept
+// on the stack in case growing triggers a collection
+void appendToList(ObjList *list, Value value)
+{
+    ValueArr *items = &list->items;
+
+    if (items->count == items->capacity)
+    {
+        size_t oldCapacity = items->capacity;
+
+        push(value);
+        items->capacity = GROW_CAPACITY(oldCapacity);
+        items->values = GROW_ARRAY(Value, items->values, oldCapacity, items->capacity);
+        pop();
+    }
+
+    items->values[items->count++] = value;
+}
+
+// negative indices count from the end, anything outside of the `length` items
+// is an error, it's shared by everything that can be indexed by position
+bool readArrayIndex(Value value, size_t length, size_t *index)
+{
+    if (!IS_NUMBER(value))
+    {
+        runtimeError("The index should be a number");
+        return false;
+    }
+
+    double number = AS_NUMBER(value);
+
+    if (number != floor(number))
+    {
+        runtimeError("The index should be an integer");
+        return false;
+    }
+
+    if (number < 0)
+        number += length;
+
+    if (number < 0 || number >= length)
+    {
+        runtimeError("The index is out of bounds");
+        return false;
+    }
+
+    *index = (size_t)number;
+    return true;
+}
+//<
+
+//> METHODS
+static bool listPush(Value *returnValue, Value *args)
+{
+    appendToList(AS_LIST(args[0]), args[1]);
+
+    *returnValue = NIL;
+    return true;
+}
+
+static bool listPop(Value *returnValue, Value *args)
+{
+    ObjList *list = AS_LIST(args[0]);
+
+    if (list->items.count == 0)
+    {
+        runtimeError("Can't pop from an empty list");
+        return false;
+    }
+
+    *returnValue = list->items.values[--list->items.count];
+    return true;
+}
+
+//> SORTING
+// lists up to this long are sorted by insertion, it's also the length of the
+// runs merge sort bottoms out at
+#define INSERTION_SORT_LENGTH 12
+
+// returns 1 if `a` should come after `b`, 0 if not, and -1 on errors
+typedef int (*Comparator)(Value a, Value b);
+
+// NaNs go after every other number
+static int numberAfter(Value a, Value b)
+{
+    double x = AS_NUMBER(a), y = AS_NUMBER(b);
+
+    return x > y || (isnan(x) && !isnan(y));
+}
+
+// the strings are flattened before sorting starts
+static int stringAfter(Value a, Value b)
+{
+    ObjString *x = AS_STRING(a), *y = AS_STRING(b);
+    size_t length = x->length < y->length ? x->length : y->length;
+    int order = memcmp(STRING_CHARS(x), STRING_CHARS(y), length);
+
+    return order > 0 || (order == 0 && x->length > y->length);
+}
+
+// the comparator is in the sort's `args[1]`, it works like the ones of other
+// languages, a positive number means `a` goes after `b`
+static Value *comparatorSlot;
+
+static int customAfter(Value a, Value b)
+{
+    Value args[] = {a, b}, order;
+
+    if (!vmCallValue(*comparatorSlot, 2, args, &order))
+        return -1;
+
+    if (!IS_NUMBER(order))
+    {
+        runtimeError("The comparator should return a number");
+        return -1;
+    }
+
+    return AS_NUMBER(order) > 0;
+}
+
+static bool insertionSort(Value *items, size_t count, Comparator after)
+{
+    for (size_t i = 1; i < count; i++)
+    {
+        Value item = items[i];
+        size_t j = i;
+        int order;
+
+        while (j > 0 && (order = after(items[j - 1], item)) == 1)
+        {
+            items[j] = items[j - 1];
+            j--;
+        }
+
+        items[j] = item;
+
+        if (order == -1)
+            return false;
+    }
+
+    return true;
+}
+
+// a stable top-down merge sort, `buffer` has room for half of the items and
+// is seen by the GC, so items that are only there during a merge stay alive
+static bool mergeSort(Value *items, Value *buffer, size_t count, Comparator after)
+{
+    if (count <= INSERTION_SORT_LENGTH)
+        return insertionSort(items, count, after);
+
+    size_t half = count / 2;
+
+    if (!mergeSort(items, buffer, half, after) || !mergeSort(items + half, buffer, count - half, after))
+        return false;
+
+    int order = after(items[half - 1], items[half]);
+
+    // the halves are already in order, which makes sorted input linear
+    if (order != 1)
+        return order == 0;
+
+    memcpy(buffer, items, sizeof(Value) * half);
+
+    size_t left = 0, right = half, target = 0;
+
+    while (left < half && right < count)
+    {
+        if ((order = after(buffer[left], items[right])) == -1)
+        {
+            // puts the items back so none of them gets lost
+            memcpy(items + target, buffer + left, sizeof(Value) * (half - left));
+            return false;
+        }
+
+        items[target++] = order ? items[right++] : buffer[left++];
+    }
+
+    memcpy(items + target, buffer + left, sizeof(Value) * (half - left));
+
+    return true;
+}
+
+// picks the comparator for lists of numbers or strings, anything else needs
+// one to be passed
+static Comparator defaultComparator(ValueArr *items)
+{
+    bool numbers = true, strings = true;
+
+    for (size_t i = 0; i < items->count && (numbers || strings); i++)
+    {
+        numbers = numbers && IS_NUMBER(items->values[i]);
+        strings = strings && IS_STRING(items->values[i]);
+    }
+
+    if (numbers)
+        return numberAfter;
+
+    if (!strings)
+        return NULL;
+
+    for (size_t i = 0; i < items->count; i++)
+        flattenString(AS_STRING(items->values[i]));
+
+    return stringAfter;
+}
+//<
+
+// sorts in place and returns the list, the items are moved out of the list
+// while it's sorted so a comparator that changes it can be caught
+static bool listSort(Value *returnValue, Value *args)
+{
+    ObjList *list = AS_LIST(args[0]);
+    Comparator after = customAfter;
+
+    *returnValue = args[0];
+
+    if (IS_NIL(args[1]))
+    {
+        after = defaultComparator(&list->items);
+
+        if (after == NULL)
+        {
+            runtimeError("Only lists of numbers or of strings can be sorted without a comparator");
+            return false;
+        }
+    }
+
+    if (list->items.count < 2)
+        return true;
+
+    // both stay on the stack so the GC sees their items
+    ObjList *buffer = allocateObjList(list->items.count / 2);
+    push(OBJ(buffer));
+
+    ObjList *sorted = allocateObjList(0);
+    push(OBJ(sorted));
+
+    for (size_t i = 0; i < buffer->items.capacity; i++)
+        buffer->items.values[buffer->items.count++] = NIL;
+
+    sorted->items = list->items;
+    initValueArr(&list->items);
+
+    Value *outerSlot = comparatorSlot;
+    comparatorSlot = &args[1];
+
+    bool succeeded = mergeSort(sorted->items.values, buffer->items.values, sorted->items.count, after);
+
+    comparatorSlot = outerSlot;
+
+    bool changed = list->items.values != NULL;
+
+    // what the comparator did to the list is dropped
+    FREE_ARRAY(Value, list->items.values, list->items.capacity);
+    list->items = sorted->items;
+    initValueArr(&sorted->items);
+
+    pop();
+    pop();
+
+    if (succeeded && changed)
+    {
+        runtimeError("The list was changed while it was being sorted");
+        return false;
+    }
+
+    return succeeded;
+}
+
+//> ITERATING
+// the function given to `map`, `filter`, `reduce`, and `forEach`, natives that
+// accept the arguments are called straight through their C function since
+// their arity only needs checking once, the rest go through `vmCallValue`
+typedef struct
+{
+    Value function;
+    NativeFun native;
+    int arity;
+} Callback;
+
+static void initCallback(Callback *callback, Value function, int argsCount)
+{
+    callback->function = function;
+    callback->native = NULL;
+
+    if (IS_NATIVE(function))
+    {
+        ObjNative *native = AS_NATIVE(function);
+
+        if (argsCount >= native->minArity && argsCount <= native->arity)
+        {
+            callback->native = native->function;
+            callback->arity = native->arity;
+        }
+    }
+}
+
+static bool runCallback(Callback *callback, int argsCount, Value *args, Value *out)
+{
+    if (callback->native == NULL)
+        return vmCallValue(callback->function, argsCount, args, out);
+
+    // the arguments are laid out on the stack like `call` does it
+    Value *slots = vm.stackTop;
+
+    push(callback->function);
+
+    for (int i = 0; i < callback->arity; i++)
+        push(i < argsCount ? args[i] : NIL);
+
+    bool succeeded = callback->native(out, slots);
+
+    vm.stackTop = slots;
+
+    return succeeded;
+}
+
+// the loops below read the count again every time since the callback can
+// change the list
+
+// a new list of what the callback returns for every item
+static bool listMap(Value *returnValue, Value *args)
+{
+    ObjList *list = AS_LIST(args[0]);
+    ObjList *mapped = allocateObjList(list->items.count);
+    Callback callback;
+    Value value;
+
+    push(OBJ(mapped));
+    initCallback(&callback, args[1], 1);
+
+    for (size_t i = 0; i < list->items.count; i++)
+    {
+        if (!runCallback(&callback, 1, &list->items.values[i], &value))
+        {
+            pop();
+            return false;
+        }
+
+        appendToList(mapped, value);
+    }
+
+    *returnValue = pop();
+    return true;
+}
+
+// a new list of the items the callback returns a truthy value for
+static bool listFilter(Value *returnValue, Value *args)
+{
+    ObjList *list = AS_LIST(args[0]);
+    ObjList *kept = allocateObjList(0);
+    Callback callback;
+    Value keep;
+
+    push(OBJ(kept));
+    initCallback(&callback, args[1], 1);
+
+    for (size_t i = 0; i < list->items.count; i++)
+    {
+        Value item = list->items.values[i];
+
+        if (!runCallback(&callback, 1, &item, &keep))
+        {
+            pop();
+            return false;
+        }
+
+        // the item might not be in the list anymore
+        if (isTruthy(keep))
+            appendToList(kept, item);
+    }
+
+    *returnValue = pop();
+    return true;
+}
+
+// folds the items from the left, it starts from the first one if there's no
+// initial value (a nil one counts as missing)
+static bool listReduce(Value *returnValue, Value *args)
+{
+    ObjList *list = AS_LIST(args[0]);
+    Callback callback;
+    size_t i = 0;
+
+    // the accumulator is kept in `args[2]` where the GC can see it
+    if (IS_NIL(args[2]))
+    {
+        if (list->items.count == 0)
+        {
+            runtimeError("Can't reduce an empty list without an initial value");
+            return false;
+        }
+
+        args[2] = list->items.values[i++];
+    }
+
+    initCallback(&callback, args[1], 2);
+
+    for (; i < list->items.count; i++)
+    {
+        Value pair[] = {args[2], list->items.values[i]};
+
+        if (!runCallback(&callback, 2, pair, &args[2]))
+            return false;
+    }
+
+    *returnValue = args[2];
+    return true;
+}
+
+static bool listForEach(Value *returnValue, Value *args)
+{
+    ObjList *list = AS_LIST(args[0]);
+    Callback callback;
+    Value ignored;
+
+    initCallback(&callback, args[1], 1);
+
+    for (size_t i = 0; i < list->items.count; i++)
+        if (!runCallback(&callback, 1, &list->items.values[i], &ignored))
+            return false;
+
+    *returnValue = NIL;
+    return true;
+}
+//<
+
+NativeDef listMethods[] = {
+    {"push", (NativeFun)listPush, 1, 1},
+    {"pop", (NativeFun)listPop, 0, 0},
+    {"sort", (NativeFun)listSort, 0, 1},
+    {"map", (NativeFun)listMap, 1, 1},
+    {"filter", (NativeFun)listFilter, 1, 1},
+    {"reduce", (NativeFun)listReduce, 1, 2},
+    {"forEach", (NativeFun)listForEach, 1, 1},
+};
+
+int listMethodsCount = sizeof(listMethods) / sizeof(NativeDef);
+//<
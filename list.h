@@ -0,0 +1,16 @@
+#ifndef clox_list_h
+#define clox_list_h
+
+#include "common.h"
+#include "vm.h"
+
+// methods of lists, they get the list they're called on in `args[0]`
+extern NativeDef listMethods[];
+
+extern int listMethodsCount;
+
+void appendToList(ObjList *, Value);
+
+bool readArrayIndex(Value, size_t, size_t *);
+
+#endif
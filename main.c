@@ -3,19 +3,36 @@
 #include "debug.h"
 #include "compiler.h"
 #include "vm.h"
+#include "cache.h"
+#include "snapshot.h"
+#include "serial.h"
+#include <string.h>
+#include <unistd.h>
 
 #define LINE_LIMIT 1024
 
-void runRepl();
+void runRepl(char[]);
 
-void runFile(char[]);
+void runFile(char[], char[]);
+
+void emitCache(char[]);
+
+void makeSnapshot(char[], char[]);
 
 int main(int argc, char *argv[])
 {
     if (argc == 1)
-        runRepl();
+        runRepl(NULL);
     else if (argc == 2)
-        runFile(argv[1]);
+        runFile(argv[1], NULL);
+    else if (argc == 3 && strcmp(argv[1], "--emit") == 0)
+        emitCache(argv[2]);
+    else if (argc == 4 && strcmp(argv[1], "--snapshot") == 0)
+        makeSnapshot(argv[2], argv[3]);
+    else if (argc == 3 && strcmp(argv[1], "--restore") == 0)
+        runRepl(argv[2]);
+    else if (argc == 4 && strcmp(argv[1], "--restore") == 0)
+        runFile(argv[3], argv[2]);
     else
         return 64;
 
@@ -27,6 +44,9 @@ int nextLine(char line[], int limit)
     char c;
     int i = 0;
 
+    // the output of the previous line should be seen before typing the next
+    flushOutput(&vm.output);
+
     while (i < limit - 1 && (c = getchar()) != EOF && c != '\n')
         line[i++] = c;
 
@@ -35,11 +55,28 @@ int nextLine(char line[], int limit)
     return i;
 }
 
-void runRepl()
+// initializes the vm from a snapshot if there's one, returns the prelude
+// source of the snapshot that should be freed after the vm
+char *startVm(char snapshot[])
 {
-    char line[LINE_LIMIT];
+    char *prelude = NULL;
+
     initVm();
 
+    if (snapshot != NULL && !restoreSnapshot(snapshot, &prelude))
+    {
+        printf("Couldn't restore '%s'\n", snapshot);
+        exit(74);
+    }
+
+    return prelude;
+}
+
+void runRepl(char snapshot[])
+{
+    char line[LINE_LIMIT];
+    char *prelude = startVm(snapshot);
+
     while (nextLine(line, LINE_LIMIT))
     {
         Scanner scanner;
@@ -62,10 +99,29 @@ void runRepl()
     }
 
     freeVm();
+    free(prelude);
 }
 
-char *readFile(char path[])
+// maps the script read-only, the rest of its last page is zeros so it's null
+// terminated for free, it's read into the heap instead (and `*mappedSize` is
+// 0) if it ends right at a page boundary or can't be mapped, since tokens
+// point into it it's only freed after the vm
+char *readFile(char path[], size_t *mappedSize)
 {
+    size_t size;
+    char *bytes = mapFile(path, &size);
+
+    if (bytes != NULL && size % sysconf(_SC_PAGESIZE) != 0)
+    {
+        *mappedSize = size;
+        return bytes;
+    }
+
+    if (bytes != NULL)
+        unmapFile(bytes, size);
+
+    *mappedSize = 0;
+
     FILE *ptr = fopen(path, "r");
 
     if (ptr == NULL)
@@ -87,9 +143,59 @@ char *readFile(char path[])
     return buffer;
 }
 
-void runFile(char path[])
+void freeFile(char *buffer, size_t mappedSize)
+{
+    if (mappedSize > 0)
+        unmapFile(buffer, mappedSize);
+    else
+        free(buffer);
+}
+
+// the cache of "script.lox" lives next to it in "script.loxc"
+char *cachePath(char path[])
+{
+    size_t length = strlen(path);
+    char *result = malloc(length + 2);
+
+    memcpy(result, path, length);
+    result[length] = 'c';
+    result[length + 1] = '\0';
+
+    return result;
+}
+
+void emitCache(char path[])
+{
+    size_t mappedSize;
+    char *buffer = readFile(path, &mappedSize);
+    char *target = cachePath(path);
+
+    initVm();
+
+    Scanner scanner;
+    initScanner(&scanner, buffer);
+
+    ObjFunction *script = compile(&scanner);
+
+    if (script == NULL)
+        exit(65);
+
+    if (!writeCache(target, script, buffer))
+    {
+        printf("Couldn't write '%s'\n", target);
+        exit(74);
+    }
+
+    free(target);
+    freeVm();
+    freeFile(buffer, mappedSize);
+}
+
+// runs a prelude then writes the resulting heap to `target`
+void makeSnapshot(char path[], char target[])
 {
-    char *buffer = readFile(path);
+    size_t mappedSize;
+    char *buffer = readFile(path, &mappedSize);
 
     initVm();
 
@@ -107,8 +213,52 @@ void runFile(char path[])
 
     call(OBJ(closure), 0);
 
+    if (run() != RESULT_SUCCESS)
+        exit(70);
+
+    if (!writeSnapshot(target, buffer))
+    {
+        printf("Couldn't write '%s'\n", target);
+        exit(74);
+    }
+
+    freeVm();
+    freeFile(buffer, mappedSize);
+}
+
+void runFile(char path[], char snapshot[])
+{
+    size_t mappedSize;
+    char *buffer = readFile(path, &mappedSize);
+    char *cache = cachePath(path);
+    char *prelude = startVm(snapshot);
+
+    ObjFunction *script = loadCache(cache, buffer);
+
+    free(cache);
+
+    if (script == NULL)
+    {
+        Scanner scanner;
+        initScanner(&scanner, buffer);
+
+        script = compile(&scanner);
+
+        if (script == NULL)
+            exit(65);
+    }
+
+    push(OBJ(script));
+    ObjClosure *closure = allocateObjClosure(script, 0);
+    pop();
+
+    push(OBJ(closure));
+
+    call(OBJ(closure), 0);
+
     run();
 
-    free(buffer);
     freeVm();
+    freeFile(buffer, mappedSize);
+    free(prelude);
 }
@@ -0,0 +1,135 @@
+#include "map.h"
+#include "list.h"
+#include "memory.h"
+
+//> METHODS
+// returns the fallback (nil by default) if the key is missing
+static bool mapGet(Value *returnValue, Value *args)
+{
+    if (!valueMapGet(&AS_MAP(args[0])->entries, args[1], returnValue))
+        *returnValue = args[2];
+
+    return true;
+}
+
+// returns the map so calls can be chained
+static bool mapSet(Value *returnValue, Value *args)
+{
+    valueMapSet(&AS_MAP(args[0])->entries, args[1], args[2]);
+
+    *returnValue = args[0];
+    return true;
+}
+
+static bool mapHas(Value *returnValue, Value *args)
+{
+    Value value;
+
+    *returnValue = BOOL(valueMapGet(&AS_MAP(args[0])->entries, args[1], &value));
+    return true;
+}
+
+// returns whether the key was there
+static bool mapRemove(Value *returnValue, Value *args)
+{
+    *returnValue = BOOL(valueMapRemove(&AS_MAP(args[0])->entries, args[1]));
+    return true;
+}
+
+// adds to the number at the key (1 by default) with a single lookup, missing
+// keys count as 0, so counting things doesn't need a `get` and a `set`
+static bool mapIncrement(Value *returnValue, Value *args)
+{
+    Value amount = IS_NIL(args[2]) ? NUMBER(1) : args[2];
+
+    if (!IS_NUMBER(amount))
+    {
+        runtimeError("The amount should be a number");
+        return false;
+    }
+
+    Value *value = valueMapSlot(&AS_MAP(args[0])->entries, args[1]);
+
+    if (IS_NIL(*value))
+        *value = NUMBER(0);
+    else if (!IS_NUMBER(*value))
+    {
+        runtimeError("Only numbers can be incremented");
+        return false;
+    }
+
+    *value = NUMBER(AS_NUMBER(*value) + AS_NUMBER(amount));
+    *returnValue = *value;
+    return true;
+}
+
+static bool mapClear(Value *returnValue, Value *args)
+{
+    freeValueMap(&AS_MAP(args[0])->entries);
+
+    *returnValue = NIL;
+    return true;
+}
+
+// copies the entries of another map over, overwriting the keys they share
+static bool mapMerge(Value *returnValue, Value *args)
+{
+    if (!IS_MAP(args[1]))
+    {
+        runtimeError("The argument should be a map");
+        return false;
+    }
+
+    ValueMap *target = &AS_MAP(args[0])->entries;
+    ValueMap *source = &AS_MAP(args[1])->entries;
+    int index = 0;
+    MapEntry *entry;
+
+    // merging a map into itself changes nothing (and would grow it while iterating)
+    if (target != source)
+        while ((entry = valueMapNext(source, &index)) != NULL)
+            valueMapSet(target, entry->key, entry->value);
+
+    *returnValue = args[0];
+    return true;
+}
+
+// a list of either the keys or the values in insertion order
+static Value collect(ObjMap *map, bool keys)
+{
+    ObjList *list = allocateObjList(map->entries.count);
+    int index = 0;
+    MapEntry *entry;
+
+    while ((entry = valueMapNext(&map->entries, &index)) != NULL)
+        list->items.values[list->items.count++] = keys ? entry->key : entry->value;
+
+    return OBJ(list);
+}
+
+static bool mapKeys(Value *returnValue, Value *args)
+{
+    *returnValue = collect(AS_MAP(args[0]), true);
+    return true;
+}
+
+static bool mapValues(Value *returnValue, Value *args)
+{
+    *returnValue = collect(AS_MAP(args[0]), false);
+    return true;
+}
+
+NativeDef mapMethods[] = {
+    {"get", (NativeFun)mapGet, 1, 2},
+    {"set", (NativeFun)mapSet, 2, 2},
+    {"has", (NativeFun)mapHas, 1, 1},
+    {"remove", (NativeFun)mapRemove, 1, 1},
+    {"increment", (NativeFun)mapIncrement, 1, 2},
+    {"clear", (NativeFun)mapClear, 0, 0},
+    {"merge", (NativeFun)mapMerge, 1, 1},
+    {"keys", (NativeFun)mapKeys, 0, 0},
+    {"values", (NativeFun)mapValues, 0, 0},
+};
+
+int mapMethodsCount = sizeof(mapMethods) / sizeof(NativeDef);
+//<
@@ -0,0 +1,12 @@
+#ifndef clox_map_h
+#define clox_map_h
+
+#include "common.h"
+#include "vm.h"
+
+// methods of maps, they get the map they're called on in `args[0]`
+extern NativeDef mapMethods[];
+
+extern int mapMethodsCount;
+
+#endif
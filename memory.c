@@ -1,12 +1,14 @@
 #include "memory.h"
 #include "chunk.h"
+#include "file.h"
+#include <string.h>
 
 void *reallocate(void *pointer, size_t oldSize, size_t newSize)
 {
     vm.allocatedBytes -= oldSize;
     vm.allocatedBytes += newSize;
 
-    if (newSize > oldSize)
+    if (newSize > oldSize && vm.deferGc == 0)
     {
 #ifdef STRESS_TEST_GC
         collectGarbage();
@@ -70,13 +72,11 @@ static void markHashMap(HashMap *hashMap)
     if (hashMap->count == 0)
         return;
 
-    for (int i = 0; i < hashMap->capacity; i++)
-    {
-        Entry *entry = &hashMap->entries[i];
-
-        if (entry->isTombstone)
-            continue;
+    int i = 0;
+    Entry *entry;
 
+    while ((entry = hashMapNext(hashMap, &i)) != NULL)
+    {
         markObj((Obj *)entry->key);
 
         markValue(entry->value);
@@ -114,6 +114,11 @@ static void markCompilerRoots()
 static void markVmRoots()
 {
     markHashMap(&vm.globals);
+    markHashMap(&vm.stringMethods);
+    markHashMap(&vm.listMethods);
+    markHashMap(&vm.mapMethods);
+    markHashMap(&vm.floatArrayMethods);
+    markHashMap(&vm.fileMethods);
 
     markArr(vm.stack, vm.stackTop - vm.stack);
 
@@ -140,6 +145,19 @@ static void blankenObj(Obj *obj)
 {
     switch (obj->type)
     {
+    case OBJ_STRING:
+    {
+        ObjString *string = (ObjString *)obj;
+
+        // the parent of a view is handled after tracing (see `retainViewParents`)
+        if (string->kind == STRING_ROPE)
+        {
+            markObj((Obj *)((ObjRope *)string)->left);
+            markObj((Obj *)((ObjRope *)string)->right);
+        }
+
+        break;
+    }
     case OBJ_FUNCTION:
     {
         ObjFunction *function = (ObjFunction *)obj;
@@ -206,6 +224,28 @@ static void blankenObj(Obj *obj)
 
         break;
     }
+    case OBJ_LIST:
+    {
+        ObjList *list = (ObjList *)obj;
+
+        markArr(list->items.values, list->items.count);
+
+        break;
+    }
+    case OBJ_MAP:
+    {
+        ObjMap *map = (ObjMap *)obj;
+        int index = 0;
+        MapEntry *entry;
+
+        while ((entry = valueMapNext(&map->entries, &index)) != NULL)
+        {
+            markValue(entry->key);
+            markValue(entry->value);
+        }
+
+        break;
+    }
     default:;
     }
 }
@@ -220,11 +260,11 @@ static void traceReferences()
     }
 }
 
-static void freeTokenArr(TokenArr *tokenArr)
+static void freePositionTable(PositionTable *positions)
 {
-    FREE_ARRAY(Token, tokenArr->tokens, tokenArr->capacity);
+    FREE_ARRAY(uint8_t, positions->bytes, positions->capacity);
 
-    initTokenArr(tokenArr);
+    initPositionTable(positions);
 }
 
 static void freeValueArr(ValueArr *valueArr)
@@ -238,18 +278,11 @@ static void freeChunk(Chunk *chunk)
 {
     FREE_ARRAY(uint8_t, chunk->code, chunk->capacity);
     freeValueArr(&chunk->constants);
-    freeTokenArr(&chunk->tokenArr);
+    freePositionTable(&chunk->positions);
 
     initChunk(chunk);
 }
 
-static void freeHashMap(HashMap *hashMap)
-{
-    FREE_ARRAY(Entry, hashMap->entries, hashMap->capacity);
-
-    initHashMap(hashMap);
-}
-
 static void freeObj(Obj *obj)
 {
     if (obj == NULL)
@@ -266,55 +299,121 @@ static void freeObj(Obj *obj)
     case OBJ_STRING:
     {
         ObjString *string = (ObjString *)obj;
-        FREE_ARRAY(char, string->chars, string->length);
+
+        if (string->kind == STRING_FLAT)
+            reallocate(obj, STRING_SIZE(string->length), 0);
+        else if (string->kind == STRING_ROPE)
+        {
+            ObjRope *rope = (ObjRope *)obj;
+
+            if (rope->chars != NULL)
+                FREE_ARRAY(char, rope->chars, string->length + 1);
+
+            FREE(ObjRope, obj);
+        }
+        else
+        {
+            ObjView *view = (ObjView *)obj;
+
+            if (view->parent == NULL)
+                FREE_ARRAY(char, view->chars, string->length + 1);
+
+            FREE(ObjView, obj);
+        }
+
         break;
     }
-
     case OBJ_FUNCTION:
         freeChunk(&((ObjFunction *)obj)->chunk);
+        FREE(ObjFunction, obj);
+        break;
+    case OBJ_NATIVE:
+        FREE(ObjNative, obj);
         break;
     case OBJ_CLOSURE:
     {
         ObjClosure *closure = (ObjClosure *)obj;
         FREE_ARRAY(ObjUpValue *, closure->upValues, closure->upValuesCount);
+        FREE(ObjClosure, obj);
         break;
     }
+    case OBJ_UPVALUE:
+        FREE(ObjUpValue, obj);
+        break;
     case OBJ_CLASS:
     {
         ObjClass *klass = (ObjClass *)obj;
         freeHashMap(&klass->methods);
+        FREE(ObjClass, obj);
         break;
     }
     case OBJ_INSTANCE:
     {
         ObjInstance *instance = (ObjInstance *)obj;
         freeHashMap(&instance->fields);
+        FREE(ObjInstance, obj);
         break;
     }
-    default:;
+    case OBJ_BOUND_METHOD:
+        FREE(ObjBoundMethod, obj);
+        break;
+    case OBJ_LIST:
+        freeValueArr(&((ObjList *)obj)->items);
+        FREE(ObjList, obj);
+        break;
+    case OBJ_MAP:
+        freeValueMap(&((ObjMap *)obj)->entries);
+        FREE(ObjMap, obj);
+        break;
+    case OBJ_FLOAT_ARRAY:
+        reallocate(obj, FLOAT_ARRAY_SIZE(((ObjFloatArray *)obj)->length), 0);
+        break;
+    case OBJ_FILE:
+        closeFile((ObjFile *)obj);
+        FREE(ObjFile, obj);
+        break;
     }
 }
 
-// Removes any entry that's not marked (its key)
-static void removeWhiteInternedStrings()
+// A parent that's only reachable through views stays alive if one of them
+// covers a good part of it, otherwise the small views copy their characters
+// so the parent can be collected
+static void retainViewParents()
 {
-    for (int i = 0; i < vm.strings.capacity; i++)
+    for (Obj *obj = vm.objects; obj != NULL; obj = obj->next)
     {
-        Entry *entry = &vm.strings.entries[i];
+        ObjView *view = (ObjView *)obj;
 
-        if (entry->key == NULL || entry->isTombstone)
+        if (obj->type != OBJ_STRING || !obj->marked || view->string.kind != STRING_VIEW || view->parent == NULL)
             continue;
 
-        if (!entry->key->obj.marked)
+        ObjString *parent = view->parent;
+
+        // parents own their characters, so there's nothing for them to trace
+        if (parent->obj.marked || view->string.length * VIEW_COMPACT_RATIO >= parent->length)
         {
-#ifdef DEBUG_STRINGS_INTERNING
-            printf("'%s' got removed from interned strings\n", entry->key->chars);
-#endif
-            hashMapRemove(&vm.strings, entry->key);
+            parent->obj.marked = true;
+            continue;
         }
+
+        vm.deferGc++;
+        char *chars = ALLOCATE(char, view->string.length + 1);
+        vm.deferGc--;
+
+        memcpy(chars, view->chars, view->string.length);
+        chars[view->string.length] = '\0';
+
+        view->chars = chars;
+        view->parent = NULL;
     }
 }
 
+// Removes any entry that's not marked (its key)
+static void removeWhiteInternedStrings()
+{
+    hashMapRemoveWhite(&vm.strings);
+}
+
 static void sweep()
 {
     Obj *prev = NULL;
@@ -333,7 +432,7 @@ static void sweep()
             cur = cur->next;
 
             freeObj(garbage);
-            free(garbage);
+            continue;
         }
 
         cur->marked = false;
@@ -355,6 +454,8 @@ void collectGarbage()
 
     traceReferences();
 
+    retainViewParents();
+
     removeWhiteInternedStrings();
 
     sweep();
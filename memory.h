@@ -8,6 +8,9 @@
 
 #define GC_GROW_FACTOR 2
 
+// views shorter than 1/ratio of their otherwise unreachable parent get compacted
+#define VIEW_COMPACT_RATIO 4
+
 #define GROW_CAPACITY(capacity) capacity < 8 ? 8 : capacity * 2
 
 #define ALLOCATE(type, count) (type *)reallocate(NULL, 0, sizeof(type) * (count))
@@ -21,6 +24,11 @@
 #define FREE_ARRAY(type, pointer, count) \
     reallocate(pointer, sizeof(type) * (count), 0)
 
+// grows an array inside the compiler's arena (never triggers a collection)
+#define GROW_ARENA_ARRAY(type, pointer, oldCount, newCount)       \
+    (type *)arenaGrow(&vm.arena, pointer, sizeof(type) * (oldCount), \
+                      sizeof(type) * (newCount))
+
 void *reallocate(void *, size_t, size_t);
 
 void collectGarbage();
@@ -0,0 +1,498 @@
+#include "number.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+//> FORMATTING
+// a float with a 64 bit significand and no implicit bit
+typedef struct
+{
+    uint64_t f;
+    int e;
+} DiyFp;
+
+typedef struct
+{
+    uint64_t significand;
+    int16_t exponent;
+} CachedPower;
+
+// normalized 10^k for k = -348, -340, ..., 340 rounded to 64 bits
+static const CachedPower cachedPowers[] = {
+    {0xfa8fd5a0081c0288ull, -1220},
+    {0xbaaee17fa23ebf76ull, -1193},
+    {0x8b16fb203055ac76ull, -1166},
+    {0xcf42894a5dce35eaull, -1140},
+    {0x9a6bb0aa55653b2dull, -1113},
+    {0xe61acf033d1a45dfull, -1087},
+    {0xab70fe17c79ac6caull, -1060},
+    {0xff77b1fcbebcdc4full, -1034},
+    {0xbe5691ef416bd60cull, -1007},
+    {0x8dd01fad907ffc3cull, -980},
+    {0xd3515c2831559a83ull, -954},
+    {0x9d71ac8fada6c9b5ull, -927},
+    {0xea9c227723ee8bcbull, -901},
+    {0xaecc49914078536dull, -874},
+    {0x823c12795db6ce57ull, -847},
+    {0xc21094364dfb5637ull, -821},
+    {0x9096ea6f3848984full, -794},
+    {0xd77485cb25823ac7ull, -768},
+    {0xa086cfcd97bf97f4ull, -741},
+    {0xef340a98172aace5ull, -715},
+    {0xb23867fb2a35b28eull, -688},
+    {0x84c8d4dfd2c63f3bull, -661},
+    {0xc5dd44271ad3cdbaull, -635},
+    {0x936b9fcebb25c996ull, -608},
+    {0xdbac6c247d62a584ull, -582},
+    {0xa3ab66580d5fdaf6ull, -555},
+    {0xf3e2f893dec3f126ull, -529},
+    {0xb5b5ada8aaff80b8ull, -502},
+    {0x87625f056c7c4a8bull, -475},
+    {0xc9bcff6034c13053ull, -449},
+    {0x964e858c91ba2655ull, -422},
+    {0xdff9772470297ebdull, -396},
+    {0xa6dfbd9fb8e5b88full, -369},
+    {0xf8a95fcf88747d94ull, -343},
+    {0xb94470938fa89bcfull, -316},
+    {0x8a08f0f8bf0f156bull, -289},
+    {0xcdb02555653131b6ull, -263},
+    {0x993fe2c6d07b7facull, -236},
+    {0xe45c10c42a2b3b06ull, -210},
+    {0xaa242499697392d3ull, -183},
+    {0xfd87b5f28300ca0eull, -157},
+    {0xbce5086492111aebull, -130},
+    {0x8cbccc096f5088ccull, -103},
+    {0xd1b71758e219652cull, -77},
+    {0x9c40000000000000ull, -50},
+    {0xe8d4a51000000000ull, -24},
+    {0xad78ebc5ac620000ull, 3},
+    {0x813f3978f8940984ull, 30},
+    {0xc097ce7bc90715b3ull, 56},
+    {0x8f7e32ce7bea5c70ull, 83},
+    {0xd5d238a4abe98068ull, 109},
+    {0x9f4f2726179a2245ull, 136},
+    {0xed63a231d4c4fb27ull, 162},
+    {0xb0de65388cc8ada8ull, 189},
+    {0x83c7088e1aab65dbull, 216},
+    {0xc45d1df942711d9aull, 242},
+    {0x924d692ca61be758ull, 269},
+    {0xda01ee641a708deaull, 295},
+    {0xa26da3999aef774aull, 322},
+    {0xf209787bb47d6b85ull, 348},
+    {0xb454e4a179dd1877ull, 375},
+    {0x865b86925b9bc5c2ull, 402},
+    {0xc83553c5c8965d3dull, 428},
+    {0x952ab45cfa97a0b3ull, 455},
+    {0xde469fbd99a05fe3ull, 481},
+    {0xa59bc234db398c25ull, 508},
+    {0xf6c69a72a3989f5cull, 534},
+    {0xb7dcbf5354e9beceull, 561},
+    {0x88fcf317f22241e2ull, 588},
+    {0xcc20ce9bd35c78a5ull, 614},
+    {0x98165af37b2153dfull, 641},
+    {0xe2a0b5dc971f303aull, 667},
+    {0xa8d9d1535ce3b396ull, 694},
+    {0xfb9b7cd9a4a7443cull, 720},
+    {0xbb764c4ca7a44410ull, 747},
+    {0x8bab8eefb6409c1aull, 774},
+    {0xd01fef10a657842cull, 800},
+    {0x9b10a4e5e9913129ull, 827},
+    {0xe7109bfba19c0c9dull, 853},
+    {0xac2820d9623bf429ull, 880},
+    {0x80444b5e7aa7cf85ull, 907},
+    {0xbf21e44003acdd2dull, 933},
+    {0x8e679c2f5e44ff8full, 960},
+    {0xd433179d9c8cb841ull, 986},
+    {0x9e19db92b4e31ba9ull, 1013},
+    {0xeb96bf6ebadf77d9ull, 1039},
+    {0xaf87023b9bf0ee6bull, 1066},
+};
+
+#define FIRST_CACHED_EXPONENT -348
+#define CACHED_EXPONENT_STEP 8
+
+static const uint64_t powersOf10[] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+    10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull, 100000000000000ull,
+    1000000000000000ull, 10000000000000000ull, 100000000000000000ull, 1000000000000000000ull,
+    10000000000000000000ull};
+
+#define SIGNIFICAND_BITS 52
+#define HIDDEN_BIT (1ull << SIGNIFICAND_BITS)
+#define EXPONENT_BIAS 1075
+
+static DiyFp fromDouble(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    int biased = (bits >> SIGNIFICAND_BITS) & 0x7ff;
+    uint64_t significand = bits & (HIDDEN_BIT - 1);
+
+    // subnormals have no hidden bit
+    if (biased == 0)
+        return (DiyFp){significand, 1 - EXPONENT_BIAS};
+
+    return (DiyFp){significand + HIDDEN_BIT, biased - EXPONENT_BIAS};
+}
+
+static DiyFp normalize(DiyFp x)
+{
+    while (!(x.f & (1ull << 63)))
+    {
+        x.f <<= 1;
+        x.e--;
+    }
+
+    return x;
+}
+
+// the upper 64 bits of the product, rounded
+static DiyFp multiply(DiyFp x, DiyFp y)
+{
+#ifdef __SIZEOF_INT128__
+    __uint128_t product = (__uint128_t)x.f * y.f;
+    uint64_t high = product >> 64, low = (uint64_t)product;
+#else
+    uint64_t a = x.f >> 32, b = (uint32_t)x.f, c = y.f >> 32, d = (uint32_t)y.f;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t middle = (bd >> 32) + (uint32_t)ad + (uint32_t)bc;
+    uint64_t high = ac + (ad >> 32) + (bc >> 32) + (middle >> 32), low = middle << 32;
+#endif
+
+    return (DiyFp){high + (low >> 63), x.e + y.e + 64};
+}
+
+// the halfway points to the neighbouring doubles, sharing the exponent of `plus`
+static void boundaries(DiyFp v, DiyFp *minus, DiyFp *plus)
+{
+    *plus = normalize((DiyFp){(v.f << 1) + 1, v.e - 1});
+
+    // the gap below a power of 2 is half the one above it
+    if (v.f == HIDDEN_BIT)
+        *minus = (DiyFp){(v.f << 2) - 1, v.e - 2};
+    else
+        *minus = (DiyFp){(v.f << 1) - 1, v.e - 1};
+
+    minus->f <<= minus->e - plus->e;
+    minus->e = plus->e;
+}
+
+// a power of 10 that brings the binary exponent of `e` into [-60, -32], its
+// decimal exponent goes in `k`
+static DiyFp cachedPower(int e, int *k)
+{
+    // ceil((-61 - e) * log10(2)) is the smallest decimal exponent that works,
+    // offset so the table index can be taken from it
+    double dk = (-61 - e) * 0.30102999566398114 - FIRST_CACHED_EXPONENT - 1;
+    int index = (int)dk;
+
+    if (dk - index > 0)
+        index++;
+
+    index = (index >> 3) + 1;
+    *k = FIRST_CACHED_EXPONENT + index * CACHED_EXPONENT_STEP;
+
+    return (DiyFp){cachedPowers[index].significand, cachedPowers[index].exponent};
+}
+
+// moves the last digit towards `w` while staying inside the boundaries
+static void roundDigit(char *digits, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t distance)
+{
+    while (rest < distance && delta - rest >= tenKappa && (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance))
+    {
+        digits[length - 1]--;
+        rest += tenKappa;
+    }
+}
+
+static int countDigits(uint32_t n)
+{
+    int count = 1;
+
+    while (count < 10 && n >= powersOf10[count])
+        count++;
+
+    return count;
+}
+
+// writes the shortest digits of `w` that are in (plus - delta, plus), and
+// adds the scale of the last digit to `exponent`
+static int generateDigits(DiyFp w, DiyFp plus, uint64_t delta, char *digits, int *exponent)
+{
+    int shift = -plus.e;
+    uint64_t one = 1ull << shift, distance = plus.f - w.f;
+    uint32_t integral = (uint32_t)(plus.f >> shift);
+    uint64_t fractional = plus.f & (one - 1);
+    int kappa = countDigits(integral);
+    int length = 0;
+
+    while (kappa > 0)
+    {
+        uint32_t digit = integral / powersOf10[kappa - 1];
+        integral %= powersOf10[kappa - 1];
+
+        if (digit != 0 || length != 0)
+            digits[length++] = '0' + digit;
+
+        kappa--;
+
+        uint64_t rest = ((uint64_t)integral << shift) + fractional;
+
+        if (rest <= delta)
+        {
+            *exponent += kappa;
+            roundDigit(digits, length, delta, rest, powersOf10[kappa] << shift, distance);
+            return length;
+        }
+    }
+
+    while (true)
+    {
+        fractional *= 10;
+        delta *= 10;
+
+        char digit = fractional >> shift;
+
+        if (digit != 0 || length != 0)
+            digits[length++] = '0' + digit;
+
+        fractional &= one - 1;
+        kappa--;
+
+        if (fractional < delta)
+        {
+            *exponent += kappa;
+            roundDigit(digits, length, delta, fractional, one, -kappa < 20 ? distance * powersOf10[-kappa] : 0);
+            return length;
+        }
+    }
+}
+
+// `value` has to be positive and finite, it's `digits * 10^exponent`
+static int grisu2(double value, char *digits, int *exponent)
+{
+    DiyFp v = fromDouble(value), minus, plus;
+    int k;
+
+    boundaries(v, &minus, &plus);
+
+    DiyFp power = cachedPower(plus.e, &k);
+    DiyFp w = multiply(normalize(v), power);
+
+    plus = multiply(plus, power);
+    minus = multiply(minus, power);
+
+    // stay strictly inside the boundaries since the products are inexact
+    plus.f--;
+    minus.f++;
+
+    *exponent = -k;
+
+    return generateDigits(w, plus, plus.f - minus.f, digits, exponent);
+}
+
+// returns the length of what got written to `buffer` without the null terminator
+int formatNumber(double value, char *buffer)
+{
+    char *start = buffer;
+
+    if (isnan(value))
+        return sprintf(buffer, "nan");
+
+    if (signbit(value))
+    {
+        *buffer++ = '-';
+        value = -value;
+    }
+
+    if (isinf(value))
+        return buffer - start + sprintf(buffer, "inf");
+
+    if (value == 0)
+        return buffer - start + sprintf(buffer, "0");
+
+    char digits[20];
+    int exponent;
+    int length = grisu2(value, digits, &exponent);
+
+    // where the decimal point goes relative to the first digit
+    int point = length + exponent;
+
+    if (length <= point && point <= 21)
+    {
+        memcpy(buffer, digits, length);
+        memset(buffer + length, '0', point - length);
+        buffer += point;
+    }
+    else if (0 < point && point <= 21)
+    {
+        memcpy(buffer, digits, point);
+        buffer[point] = '.';
+        memcpy(buffer + point + 1, digits + point, length - point);
+        buffer += length + 1;
+    }
+    else if (-6 < point && point <= 0)
+    {
+        buffer[0] = '0';
+        buffer[1] = '.';
+        memset(buffer + 2, '0', -point);
+        memcpy(buffer + 2 - point, digits, length);
+        buffer += length + 2 - point;
+    }
+    else
+    {
+        *buffer++ = digits[0];
+
+        if (length > 1)
+        {
+            *buffer++ = '.';
+            memcpy(buffer, digits + 1, length - 1);
+            buffer += length - 1;
+        }
+
+        buffer += sprintf(buffer, "e%+d", point - 1);
+    }
+
+    *buffer = '\0';
+
+    return buffer - start;
+}
+
+#undef SIGNIFICAND_BITS
+#undef HIDDEN_BIT
+#undef EXPONENT_BIAS
+//<
+
+//> PARSING
+// the doubles that hold every power of 10 exactly
+static const double exactPowersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+#define MAX_EXACT_POWER 22
+#define MAX_EXACT_INTEGER (1ull << 53)
+#define MAX_DIGITS 19
+
+static double slowParse(char *chars, int length)
+{
+    char small[64];
+    char *copy = length < sizeof(small) ? small : malloc(length + 1);
+
+    if (copy == NULL)
+    {
+        printf("Falied failed allocating memory\n");
+        exit(71);
+    }
+
+    memcpy(copy, chars, length);
+    copy[length] = '\0';
+
+    double value = strtod(copy, NULL);
+
+    if (copy != small)
+        free(copy);
+
+    return value;
+}
+
+static bool isDigitChar(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/*
+    Plain decimals like "12.5" or "-3e4" whose digits fit in 53 bits and
+    whose exponent is at most 22 are exact doubles multiplied or divided by
+    an exact power of 10, which rounds correctly in a single operation
+    (Clinger's fast path). Anything else, including what `strtod` accepts
+    but the fast path doesn't (spaces, hex, inf), goes through `strtod`.
+*/
+double parseNumber(char *chars, int length)
+{
+#if FLT_EVAL_METHOD == 0
+    int i = 0;
+    bool negative = false;
+
+    if (i < length && (chars[i] == '-' || chars[i] == '+'))
+        negative = chars[i++] == '-';
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    int start = i;
+
+    for (; i < length && isDigitChar(chars[i]); i++)
+    {
+        mantissa = mantissa * 10 + (chars[i] - '0');
+        digits += mantissa != 0;
+    }
+
+    if (i < length && chars[i] == '.')
+    {
+        int point = ++i;
+
+        for (; i < length && isDigitChar(chars[i]); i++)
+        {
+            mantissa = mantissa * 10 + (chars[i] - '0');
+            digits += mantissa != 0;
+        }
+
+        exponent -= i - point;
+
+        // a lonely "." isn't a number
+        if (i - start == 1)
+            return slowParse(chars, length);
+    }
+
+    if (i < length && (chars[i] == 'e' || chars[i] == 'E') && i > start)
+    {
+        int sign = 1, value = 0;
+
+        i++;
+
+        if (i < length && (chars[i] == '-' || chars[i] == '+'))
+            sign = chars[i++] == '-' ? -1 : 1;
+
+        if (i == length || !isDigitChar(chars[i]))
+            return slowParse(chars, length);
+
+        for (; i < length && isDigitChar(chars[i]); i++)
+            if (value < 10000)
+                value = value * 10 + (chars[i] - '0');
+
+        exponent += sign * value;
+    }
+
+    if (i == start || i != length || digits > MAX_DIGITS)
+        return slowParse(chars, length);
+
+    if (mantissa == 0)
+        return negative ? -0.0 : 0.0;
+
+    // moves the extra zeros of something like 12e25 into the mantissa
+    while (exponent > MAX_EXACT_POWER && mantissa < MAX_EXACT_INTEGER / 10)
+    {
+        mantissa *= 10;
+        exponent--;
+    }
+
+    if (mantissa > MAX_EXACT_INTEGER || exponent < -MAX_EXACT_POWER || exponent > MAX_EXACT_POWER)
+        return slowParse(chars, length);
+
+    double value = (double)mantissa;
+
+    if (exponent < 0)
+        value /= exactPowersOf10[-exponent];
+    else
+        value *= exactPowersOf10[exponent];
+
+    return negative ? -value : value;
+#else
+    return slowParse(chars, length);
+#endif
+}
+
+#undef MAX_EXACT_POWER
+#undef MAX_EXACT_INTEGER
+#undef MAX_DIGITS
+//<
@@ -0,0 +1,21 @@
+#ifndef clox_number_h
+#define clox_number_h
+
+#include "common.h"
+
+// enough for "-1.2345678901234567e-308" and the null terminator
+#define NUMBER_BUFFER_SIZE 32
+
+/*
+    Numbers are written with the fewest digits that read back to the same
+    double (Grisu2), laid out like JavaScript does:
+        * integers up to 1e21 in full: 100, 123456789
+        * fractions down to 1e-7 in fixed notation: 0.1, 0.000001
+        * everything else in exponential notation: 1e+21, 5e-324
+*/
+int formatNumber(double, char *);
+
+// parses like `strtod` but only needs a length, not a null terminator
+double parseNumber(char *, int);
+
+#endif
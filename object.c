@@ -3,18 +3,37 @@
 #include "memory.h"
 #include <string.h>
 
+static void trackObj(Obj *obj, ObjType type)
+{
+    obj->type = type;
+    obj->marked = false;
+    obj->next = (struct Obj *)vm.objects;
+    vm.objects = obj;
+}
+
 static Obj *allocateObj(size_t size, ObjType type)
 {
     Obj *ptr = reallocate(NULL, 0, size);
 
-    ptr->type = type;
-    ptr->marked = false;
-    ptr->next = (struct Obj *)vm.objects;
-    vm.objects = ptr;
+    trackObj(ptr, type);
 
     return ptr;
 }
 
+static void internString(ObjString *string)
+{
+#ifdef DEBUG_GC
+    printValue(OBJ(string));
+    putchar('\n');
+#endif
+
+    hashMapInsert(&vm.strings, string, NIL);
+
+#ifdef DEBUG_STRINGS_INTERNING
+    printf("'%s' got interned\n", string->chars);
+#endif
+}
+
 ObjString *allocateObjString(char *s, int length)
 {
     uint32_t hash = hashString(s, length);
@@ -23,30 +42,185 @@ ObjString *allocateObjString(char *s, int length)
     if (interned != NULL)
         return interned;
 
-    char *chars = ALLOCATE(char, length + 1);
-    strncpy(chars, s, length);
-    chars[length] = '\0';
-
-    ObjString *ptr = (ObjString *)allocateObj(sizeof(ObjString), OBJ_STRING);
+    ObjString *ptr = (ObjString *)allocateObj(STRING_SIZE(length), OBJ_STRING);
 
-    ptr->chars = chars;
-    ptr->length = strlen(chars);
+    ptr->kind = STRING_FLAT;
+    ptr->interned = true;
+    ptr->hashed = true;
+    memcpy(ptr->chars, s, length);
+    ptr->chars[length] = '\0';
+    ptr->length = length;
     ptr->hash = hash;
 
-#ifdef DEBUG_GC
-    printValue(OBJ(ptr));
-    putchar('\n');
-#endif
+    internString(ptr);
 
-    hashMapInsert(&vm.strings, ptr, NIL);
+    return ptr;
+}
 
-#ifdef DEBUG_STRINGS_INTERNING
-    printf("'%.*s' got interned\n", length, chars);
-#endif
+// allocates a string that the GC doesn't know about yet, the caller fills its
+// characters and then passes it to `trackObjString`
+ObjString *reserveObjString(int length)
+{
+    ObjString *ptr = reallocate(NULL, 0, STRING_SIZE(length));
+
+    ptr->kind = STRING_FLAT;
+    ptr->interned = false;
+    ptr->hashed = false;
+    ptr->length = length;
+    ptr->chars[length] = '\0';
 
     return ptr;
 }
 
+ObjString *trackObjString(ObjString *string)
+{
+    trackObj(&string->obj, OBJ_STRING);
+
+    return string;
+}
+
+ObjString *allocateUninternedObjString(char *s, int length)
+{
+    ObjString *string = reserveObjString(length);
+
+    memcpy(string->chars, s, length);
+
+    return trackObjString(string);
+}
+
+ObjString *allocateObjRope(ObjString *left, ObjString *right)
+{
+    ObjRope *ptr = (ObjRope *)allocateObj(sizeof(ObjRope), OBJ_STRING);
+
+    ptr->string.kind = STRING_ROPE;
+    ptr->string.interned = false;
+    ptr->string.hashed = false;
+    ptr->string.length = left->length + right->length;
+    ptr->string.hash = 0;
+    ptr->chars = NULL;
+    ptr->left = left;
+    ptr->right = right;
+
+    return &ptr->string;
+}
+
+// short substrings are copied, long ones share the characters of their parent
+ObjString *allocateObjView(ObjString *parent, size_t start, size_t length)
+{
+    // a collection could compact the parent (if it's a view) under our feet
+    vm.deferGc++;
+
+    char *chars = flattenString(parent) + start;
+
+    if (length < VIEW_MIN_LENGTH)
+    {
+        ObjString *copy = allocateUninternedObjString(chars, length);
+        vm.deferGc--;
+        return copy;
+    }
+
+    // views of views share the original parent, unless they own a copy
+    if (parent->kind == STRING_VIEW && ((ObjView *)parent)->parent != NULL)
+        parent = ((ObjView *)parent)->parent;
+
+    ObjView *ptr = (ObjView *)allocateObj(sizeof(ObjView), OBJ_STRING);
+    vm.deferGc--;
+
+    ptr->string.kind = STRING_VIEW;
+    ptr->string.interned = false;
+    ptr->string.hashed = false;
+    ptr->string.length = length;
+    ptr->string.hash = 0;
+    ptr->chars = chars;
+    ptr->parent = parent;
+
+    return &ptr->string;
+}
+
+// copies the leaves into one buffer from right to left, it's done iteratively
+// since ropes built by loops are as deep as the loop is long
+static void flattenRope(ObjRope *rope)
+{
+    vm.deferGc++;
+    char *chars = ALLOCATE(char, rope->string.length + 1);
+    vm.deferGc--;
+
+    int capacity = 8, count = 0;
+    ObjString **stack = malloc(sizeof(ObjString *) * capacity);
+    size_t end = rope->string.length;
+
+    stack[count++] = &rope->string;
+
+    while (count > 0)
+    {
+        ObjString *node = stack[--count];
+        char *nodeChars = STRING_CHARS(node);
+
+        if (nodeChars != NULL)
+        {
+            end -= node->length;
+            memcpy(chars + end, nodeChars, node->length);
+            continue;
+        }
+
+        if (count + 2 > capacity)
+        {
+            capacity *= 2;
+            stack = realloc(stack, sizeof(ObjString *) * capacity);
+        }
+
+        if (stack == NULL)
+        {
+            printf("Falied failed allocating memory\n");
+            exit(71);
+        }
+
+        stack[count++] = ((ObjRope *)node)->left;
+        stack[count++] = ((ObjRope *)node)->right;
+    }
+
+    free(stack);
+
+    chars[rope->string.length] = '\0';
+    rope->chars = chars;
+
+    // the children can be collected now
+    rope->left = rope->right = NULL;
+}
+
+// returns the characters of the string, flattening it first if it's a rope
+// (they're not null terminated for views, so `length` should be used)
+char *flattenString(ObjString *string)
+{
+    if (string->kind == STRING_ROPE && ((ObjRope *)string)->chars == NULL)
+        flattenRope((ObjRope *)string);
+
+    return STRING_CHARS(string);
+}
+
+uint32_t hashObjString(ObjString *string)
+{
+    if (!string->hashed)
+    {
+        string->hash = hashString(flattenString(string), string->length);
+        string->hashed = true;
+    }
+
+    return string->hash;
+}
+
+// interned strings are only equal to themselves
+bool equalStrings(ObjString *a, ObjString *b)
+{
+    if (a == b)
+        return true;
+
+    if ((a->interned && b->interned) || a->length != b->length || hashObjString(a) != hashObjString(b))
+        return false;
+
+    return memcmp(flattenString(a), flattenString(b), a->length) == 0;
+}
+
 ObjFunction *allocateObjFunction()
 {
     ObjFunction *ptr = (ObjFunction *)allocateObj(sizeof(ObjFunction), OBJ_FUNCTION);
@@ -64,10 +238,11 @@ ObjFunction *allocateObjFunction()
     return ptr;
 }
 
-ObjNative *allocateObjNative(uint8_t arity, NativeFun function)
+ObjNative *allocateObjNative(uint8_t minArity, uint8_t arity, NativeFun function)
 {
     ObjNative *ptr = (ObjNative *)allocateObj(sizeof(ObjNative), OBJ_NATIVE);
 
+    ptr->minArity = minArity;
     ptr->arity = arity;
     ptr->function = function;
 
@@ -170,3 +345,78 @@ ObjBoundMethod *allocateObjBoundMethod(ObjInstance *instance, ObjClosure *method
 
     return ptr;
 }
+
+// the list is empty but has room for `capacity` items
+ObjList *allocateObjList(int capacity)
+{
+    ObjList *ptr = (ObjList *)allocateObj(sizeof(ObjList), OBJ_LIST);
+
+    initValueArr(&ptr->items);
+
+    push(OBJ(ptr));
+    ptr->items.values = ALLOCATE(Value, capacity);
+    ptr->items.capacity = capacity;
+    pop();
+
+#ifdef DEBUG_GC
+    printValue(OBJ(ptr));
+    putchar('\n');
+#endif
+
+    return ptr;
+}
+
+ObjMap *allocateObjMap()
+{
+    ObjMap *ptr = (ObjMap *)allocateObj(sizeof(ObjMap), OBJ_MAP);
+
+    initValueMap(&ptr->entries);
+
+#ifdef DEBUG_GC
+    printValue(OBJ(ptr));
+    putchar('\n');
+#endif
+
+    return ptr;
+}
+
+// the values start as zeros
+ObjFloatArray *allocateObjFloatArray(size_t length)
+{
+    ObjFloatArray *ptr = (ObjFloatArray *)allocateObj(FLOAT_ARRAY_SIZE(length), OBJ_FLOAT_ARRAY);
+
+    ptr->length = length;
+    memset(ptr->values, 0, sizeof(double) * length);
+
+#ifdef DEBUG_GC
+    printValue(OBJ(ptr));
+    putchar('\n');
+#endif
+
+    return ptr;
+}
+
+// a closed file (-1) gets no buffer
+ObjFile *allocateObjFile(int fd)
+{
+    ObjFile *ptr = (ObjFile *)allocateObj(sizeof(ObjFile), OBJ_FILE);
+
+    ptr->fd = fd;
+    ptr->buffer = NULL;
+    ptr->capacity = ptr->start = ptr->end = 0;
+
+    if (fd != -1)
+    {
+        push(OBJ(ptr));
+        ptr->buffer = ALLOCATE(char, FILE_BUFFER_SIZE);
+        ptr->capacity = FILE_BUFFER_SIZE;
+        pop();
+    }
+
+#ifdef DEBUG_GC
+    printValue(OBJ(ptr));
+    putchar('\n');
+#endif
+
+    return ptr;
+}
@@ -5,6 +5,7 @@
 #include "chunk.h"
 #include "value.h"
 #include "hashmap.h"
+#include "valuemap.h"
 
 typedef enum
 {
@@ -16,6 +17,10 @@ typedef enum
     OBJ_CLASS,
     OBJ_INSTANCE,
     OBJ_BOUND_METHOD,
+    OBJ_LIST,
+    OBJ_MAP,
+    OBJ_FLOAT_ARRAY,
+    OBJ_FILE,
 } ObjType;
 
 typedef struct Obj
@@ -25,14 +30,54 @@ typedef struct Obj
     struct Obj *next;
 } Obj;
 
+// concatenations at least this long build ropes instead of copying
+#define ROPE_MIN_LENGTH 256
+
+// substrings shorter than this are copied instead of viewing their parent
+#define VIEW_MIN_LENGTH 32
+
+typedef enum
+{
+    STRING_FLAT, // the characters are stored right after the header
+    STRING_ROPE, // the concatenation of two strings, it owns a buffer once flattened
+    STRING_VIEW, // a slice of the characters of its parent (not null terminated)
+} StringKind;
+
+// only strings made by the compiler (or restored) are interned, the ones made at
+// runtime are compared by content and hashed on demand (see `hashObjString`)
 typedef struct ObjString
 {
     Obj obj;
-    size_t length;
-    char *chars;
+    uint8_t kind; // a `StringKind`, which picks the struct the header is part of
+    bool interned;
+    bool hashed;
     uint32_t hash;
+    size_t length;
+    char chars[]; // only flat strings have these, use `STRING_CHARS` for the rest
 } ObjString;
 
+#define STRING_SIZE(length) (sizeof(ObjString) + (length) + 1)
+
+// ropes and views start the same way, so the pointer to their characters is
+// found at the same place for both
+typedef struct
+{
+    ObjString string;
+    char *chars; // null terminated, NULL till the rope is flattened (see `flattenString`)
+    ObjString *left;
+    ObjString *right; // the children are dropped once the rope is flattened
+} ObjRope;
+
+typedef struct
+{
+    ObjString string;
+    char *chars;
+    ObjString *parent; // owns its characters, NULL once the view owns a copy
+} ObjView;
+
+// the characters of any kind of string, NULL for a rope that isn't flattened
+#define STRING_CHARS(string) ((string)->kind == STRING_FLAT ? (string)->chars : ((ObjRope *)(string))->chars)
+
 #define IS_OBJ_TYPE(val, typ) (AS_OBJ(val)->type == typ)
 
 #define IS_STRING(val) (IS_OBJ(val) && IS_OBJ_TYPE(val, OBJ_STRING))
@@ -54,9 +99,11 @@ struct Compiler;
 
 typedef bool (*NativeFun)(Value *returnValue, Value *args);
 
+// missing optional arguments (after `minArity`) are passed as nil
 typedef struct
 {
     Obj obj;
+    uint8_t minArity;
     uint8_t arity;
     NativeFun function;
 } ObjNative;
@@ -118,11 +165,77 @@ typedef struct
 #define IS_BOUND_METHOD(val) (IS_OBJ(val) && IS_OBJ_TYPE(val, OBJ_BOUND_METHOD))
 #define AS_BOUND_METHOD(val) ((ObjBoundMethod *)AS_OBJ(val))
 
+typedef struct
+{
+    Obj obj;
+    ValueArr items;
+} ObjList;
+
+#define IS_LIST(val) (IS_OBJ(val) && IS_OBJ_TYPE(val, OBJ_LIST))
+#define AS_LIST(val) ((ObjList *)AS_OBJ(val))
+
+typedef struct
+{
+    Obj obj;
+    ValueMap entries;
+} ObjMap;
+
+#define IS_MAP(val) (IS_OBJ(val) && IS_OBJ_TYPE(val, OBJ_MAP))
+#define AS_MAP(val) ((ObjMap *)AS_OBJ(val))
+
+// a fixed length array of raw doubles, stored right after the header so the
+// kernels in `simd.h` can run over them
+typedef struct
+{
+    Obj obj;
+    size_t length;
+    double values[];
+} ObjFloatArray;
+
+#define FLOAT_ARRAY_SIZE(length) (sizeof(ObjFloatArray) + sizeof(double) * (length))
+
+#define IS_FLOAT_ARRAY(val) (IS_OBJ(val) && IS_OBJ_TYPE(val, OBJ_FLOAT_ARRAY))
+#define AS_FLOAT_ARRAY(val) ((ObjFloatArray *)AS_OBJ(val))
+
+// the size its buffer starts with, it only grows for longer lines
+#define FILE_BUFFER_SIZE (64 * 1024)
+
+// a file opened for reading, the bytes between `start` and `end` of its
+// buffer are read but not consumed yet, `fd` is -1 once it's closed
+typedef struct
+{
+    Obj obj;
+    int fd;
+    char *buffer;
+    size_t capacity;
+    size_t start;
+    size_t end;
+} ObjFile;
+
+#define IS_FILE(val) (IS_OBJ(val) && IS_OBJ_TYPE(val, OBJ_FILE))
+#define AS_FILE(val) ((ObjFile *)AS_OBJ(val))
+
 ObjString *allocateObjString(char *, int);
 
+ObjString *reserveObjString(int);
+
+ObjString *trackObjString(ObjString *);
+
+ObjString *allocateUninternedObjString(char *, int);
+
+uint32_t hashObjString(ObjString *);
+
+ObjString *allocateObjRope(ObjString *, ObjString *);
+
+ObjString *allocateObjView(ObjString *, size_t, size_t);
+
+char *flattenString(ObjString *);
+
+bool equalStrings(ObjString *, ObjString *);
+
 ObjFunction *allocateObjFunction(void);
 
-ObjNative *allocateObjNative(uint8_t, NativeFun);
+ObjNative *allocateObjNative(uint8_t, uint8_t, NativeFun);
 
 ObjUpValue *allocateObjUpValue(Value *);
 
@@ -134,4 +247,12 @@ ObjInstance *allocateObjInstance(ObjClass *);
 
 ObjBoundMethod *allocateObjBoundMethod(ObjInstance *, ObjClosure *);
 
+ObjList *allocateObjList(int);
+
+ObjMap *allocateObjMap(void);
+
+ObjFloatArray *allocateObjFloatArray(size_t);
+
+ObjFile *allocateObjFile(int);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "output.h"
+#include <string.h>
+
+void initOutput(Output *output, OutputMode mode)
+{
+    output->mode = mode;
+    output->count = 0;
+}
+
+void flushOutput(Output *output)
+{
+    fwrite(output->bytes, 1, output->count, stdout);
+    fflush(stdout);
+
+    output->count = 0;
+}
+
+void writeOutput(Output *output, char *bytes, size_t length)
+{
+    if (output->mode == OUTPUT_DIRECT)
+    {
+        fwrite(bytes, 1, length, stdout);
+        return;
+    }
+
+    if (output->count + length > OUTPUT_BUFFER_SIZE)
+    {
+        flushOutput(output);
+
+        // too big to be worth copying
+        if (length > OUTPUT_BUFFER_SIZE)
+        {
+            fwrite(bytes, 1, length, stdout);
+            return;
+        }
+    }
+
+    memcpy(output->bytes + output->count, bytes, length);
+    output->count += length;
+
+    if (output->mode == OUTPUT_LINE && memchr(bytes, '\n', length) != NULL)
+        flushOutput(output);
+}
+
+void writeOutputString(Output *output, char *string)
+{
+    writeOutput(output, string, strlen(string));
+}
+
+void writeOutputChar(Output *output, char c)
+{
+    // the common case skips the checks of `writeOutput`
+    if (output->mode == OUTPUT_BLOCK && output->count < OUTPUT_BUFFER_SIZE)
+    {
+        output->bytes[output->count++] = c;
+        return;
+    }
+
+    writeOutput(output, &c, 1);
+}
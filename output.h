@@ -0,0 +1,35 @@
+#ifndef clox_output_h
+#define clox_output_h
+
+#include "common.h"
+
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+typedef enum
+{
+    OUTPUT_BLOCK,  // written when the buffer fills up or gets flushed
+    OUTPUT_LINE,   // written after every line, for terminals
+    OUTPUT_DIRECT, // nothing is buffered, for the debug flags that use printf
+} OutputMode;
+
+// What scripts print goes through this buffer instead of a stdio call per
+// value, it's flushed when it's full, by `flush()`, before errors get reported
+// and stdin gets read, and by `freeVm`
+typedef struct
+{
+    OutputMode mode;
+    size_t count;
+    char bytes[OUTPUT_BUFFER_SIZE];
+} Output;
+
+void initOutput(Output *, OutputMode);
+
+void writeOutput(Output *, char *, size_t);
+
+void writeOutputString(Output *, char *);
+
+void writeOutputChar(Output *, char);
+
+void flushOutput(Output *);
+
+#endif
@@ -18,6 +18,9 @@ static char *reportTypeToString(ReportType type)
 // vm pointers is passed only for runtime errors
 void report(ReportType type, Token *token, char msg[])
 {
+    // what got printed before the error should show up before it
+    flushOutput(&vm.output);
+
     puts("\n---");
 
     int pos[2];
@@ -51,9 +54,10 @@ void report(ReportType type, Token *token, char msg[])
         {
             CallFrame *frame = &vm.frames[i];
             CallFrame *parentFrame = &vm.frames[i - 1];
-            Token token = parentFrame->closure->function->chunk.tokenArr.tokens[(int)(parentFrame->ip - parentFrame->closure->function->chunk.code - 1)];
+            Chunk *chunk = &parentFrame->closure->function->chunk;
+            Token token = getTokenAt(chunk, (int)(parentFrame->ip - chunk->code - 1));
 
-            if (frame->closure->function->name->chars)
+            if (frame->closure->function->name != NULL)
             {
                 int pos[2];
 
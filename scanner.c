@@ -1,33 +1,115 @@
 #include "scanner.h"
 #include <string.h>
 
-void getTokenPos(int pos[2], Token *token)
+// line starts of a source, built on the first lookup of a position in it
+typedef struct
+{
+    char *source;
+    int count; // 0 till the index is built
+    int capacity;
+    int *starts;
+} LineIndex;
+
+// one index per source a position was asked for (the script, the snapshot's
+// prelude, the REPL's line buffer), `initScanner` drops the index of the source
+// it's given since source buffers get reused
+static struct
+{
+    int count;
+    int capacity;
+    LineIndex *indexes;
+} lineIndexes;
+
+static void *growArray(void *array, int *capacity, size_t itemSize)
+{
+    *capacity = *capacity < 8 ? 8 : *capacity * 2;
+    array = realloc(array, itemSize * *capacity);
+
+    if (array == NULL)
+    {
+        printf("Falied failed allocating memory\n");
+        exit(71);
+    }
+
+    return array;
+}
+
+static LineIndex *findLineIndex(char *source)
 {
-    int i;
+    for (int i = 0; i < lineIndexes.count; i++)
+    {
+        if (lineIndexes.indexes[i].source == source)
+            return &lineIndexes.indexes[i];
+    }
+
+    return NULL;
+}
 
-    i = pos[1] = 0;
-    pos[0] = 1;
+static void buildLineIndex(LineIndex *lineIndex)
+{
+    char *current = lineIndex->source;
 
     while (1)
     {
-        if (token->source[i] == '\n')
-            pos[0]++;
+        if (lineIndex->count == lineIndex->capacity)
+            lineIndex->starts = growArray(lineIndex->starts, &lineIndex->capacity, sizeof(int));
 
-        if ((token->source + i) == token->start)
+        lineIndex->starts[lineIndex->count++] = current - lineIndex->source;
+
+        char *newLine = strchr(current, '\n');
+
+        if (newLine == NULL)
             break;
 
-        i++;
+        current = newLine + 1;
+    }
+}
+
+void getTokenPos(int pos[2], Token *token)
+{
+    LineIndex *lineIndex = findLineIndex(token->source);
+
+    if (lineIndex == NULL)
+    {
+        if (lineIndexes.count == lineIndexes.capacity)
+            lineIndexes.indexes = growArray(lineIndexes.indexes, &lineIndexes.capacity, sizeof(LineIndex));
+
+        lineIndex = &lineIndexes.indexes[lineIndexes.count++];
+        lineIndex->source = token->source;
+        lineIndex->count = 0;
+        lineIndex->capacity = 0;
+        lineIndex->starts = NULL;
     }
 
-    while (i >= 0 && token->source[i] != '\n')
+    if (lineIndex->count == 0)
+        buildLineIndex(lineIndex);
+
+    int offset = token->start - token->source;
+    int low = 0, high = lineIndex->count - 1;
+
+    // the last line that starts before the token
+    while (low < high)
     {
-        pos[1]++;
-        i--;
+        int middle = low + (high - low + 1) / 2;
+
+        if (lineIndex->starts[middle] <= offset)
+            low = middle;
+        else
+            high = middle - 1;
     }
+
+    pos[0] = low + 1;
+    pos[1] = offset - lineIndex->starts[low] + 1;
 }
 
 void initScanner(Scanner *scanner, char source[])
 {
+    LineIndex *lineIndex = findLineIndex(source);
+
+    // the buffer may hold a different source now, so it's indexed again
+    if (lineIndex != NULL)
+        lineIndex->count = 0;
+
     scanner->source = source;
     scanner->current = source;
     scanner->start = source;
@@ -305,6 +387,10 @@ Token scanToken(Scanner *scanner)
         }
         else
             return popToken(scanner, TOKEN_RIGHT_BRACE);
+    case '[':
+        return popToken(scanner, TOKEN_LEFT_BRACKET);
+    case ']':
+        return popToken(scanner, TOKEN_RIGHT_BRACKET);
     case ',':
         return popToken(scanner, TOKEN_COMMA);
     case '.':
@@ -0,0 +1,164 @@
+#include "serial.h"
+#include "memory.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// FNV-1a (64-bit), it's not seeded so it's stable across runs
+uint64_t hashBytes(char *bytes, size_t length)
+{
+    uint64_t hash = 14695981039346656037u;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (uint8_t)bytes[i];
+        hash *= 1099511628211u;
+    }
+
+    return hash;
+}
+
+//> WRITING
+void initWriter(Writer *writer)
+{
+    writer->count = 0;
+    writer->capacity = 0;
+    writer->bytes = NULL;
+}
+
+void writeBytes(Writer *writer, void *bytes, size_t count)
+{
+    if (writer->count + count > writer->capacity)
+    {
+        while (writer->count + count > writer->capacity)
+            writer->capacity = GROW_CAPACITY(writer->capacity);
+
+        writer->bytes = realloc(writer->bytes, writer->capacity);
+
+        if (writer->bytes == NULL)
+        {
+            printf("Falied failed allocating memory\n");
+            exit(71);
+        }
+    }
+
+    if (count > 0)
+        memcpy(writer->bytes + writer->count, bytes, count);
+
+    writer->count += count;
+}
+
+void writeU8(Writer *writer, uint8_t value)
+{
+    writeBytes(writer, &value, sizeof(value));
+}
+
+void writeU32(Writer *writer, uint32_t value)
+{
+    writeBytes(writer, &value, sizeof(value));
+}
+
+void writeDouble(Writer *writer, double value)
+{
+    writeBytes(writer, &value, sizeof(value));
+}
+
+// returns whether the whole content got written
+bool writeToFile(Writer *writer, char *path)
+{
+    FILE *ptr = fopen(path, "wb");
+
+    if (ptr == NULL)
+        return false;
+
+    bool written = fwrite(writer->bytes, 1, writer->count, ptr) == writer->count;
+
+    return fclose(ptr) == 0 && written;
+}
+
+void freeWriter(Writer *writer)
+{
+    free(writer->bytes);
+    initWriter(writer);
+}
+//<
+
+//> READING
+// returns NULL (and marks the reader as failed) if there aren't enough bytes left
+void *readBytes(Reader *reader, size_t count)
+{
+    if (reader->failed || (size_t)(reader->end - reader->current) < count)
+    {
+        reader->failed = true;
+        return NULL;
+    }
+
+    void *bytes = reader->current;
+    reader->current += count;
+
+    return bytes;
+}
+
+uint8_t readU8(Reader *reader)
+{
+    uint8_t *bytes = readBytes(reader, sizeof(uint8_t));
+
+    return bytes == NULL ? 0 : *bytes;
+}
+
+uint32_t readU32(Reader *reader)
+{
+    uint32_t value = 0;
+    void *bytes = readBytes(reader, sizeof(value));
+
+    if (bytes != NULL)
+        memcpy(&value, bytes, sizeof(value));
+
+    return value;
+}
+
+double readDouble(Reader *reader)
+{
+    double value = 0;
+    void *bytes = readBytes(reader, sizeof(value));
+
+    if (bytes != NULL)
+        memcpy(&value, bytes, sizeof(value));
+
+    return value;
+}
+
+// maps a whole file read-only, returns NULL if it's missing or empty
+void *mapFile(char *path, size_t *size)
+{
+    int fd = open(path, O_RDONLY);
+
+    if (fd == -1)
+        return NULL;
+
+    struct stat info;
+
+    if (fstat(fd, &info) == -1 || info.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    void *bytes = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (bytes == MAP_FAILED)
+        return NULL;
+
+    *size = info.st_size;
+
+    return bytes;
+}
+
+void unmapFile(void *bytes, size_t size)
+{
+    munmap(bytes, size);
+}
+//<
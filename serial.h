@@ -0,0 +1,51 @@
+#ifndef clox_serial_h
+#define clox_serial_h
+
+#include "common.h"
+
+// primitives shared by the on-disk formats (`.loxc` caches and heap snapshots),
+// values are written in the machine's byte order
+
+typedef struct
+{
+    size_t count;
+    size_t capacity;
+    uint8_t *bytes;
+} Writer;
+
+typedef struct
+{
+    uint8_t *current;
+    uint8_t *end;
+    bool failed;
+} Reader;
+
+uint64_t hashBytes(char *, size_t);
+
+void initWriter(Writer *);
+
+void writeBytes(Writer *, void *, size_t);
+
+void writeU8(Writer *, uint8_t);
+
+void writeU32(Writer *, uint32_t);
+
+void writeDouble(Writer *, double);
+
+bool writeToFile(Writer *, char *);
+
+void freeWriter(Writer *);
+
+void *readBytes(Reader *, size_t);
+
+uint8_t readU8(Reader *);
+
+uint32_t readU32(Reader *);
+
+double readDouble(Reader *);
+
+void *mapFile(char *, size_t *);
+
+void unmapFile(void *, size_t);
+
+#endif
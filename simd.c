@@ -0,0 +1,187 @@
+#include "simd.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+
+#define LANES 4
+typedef __m256d Vector;
+
+#define SPLAT(x) _mm256_set1_pd(x)
+#define LOAD(pointer) _mm256_loadu_pd(pointer)
+#define STORE(pointer, vector) _mm256_storeu_pd(pointer, vector)
+#define ADD(a, b) _mm256_add_pd(a, b)
+#define MUL(a, b) _mm256_mul_pd(a, b)
+#define MIN(a, b) _mm256_min_pd(a, b)
+#define MAX(a, b) _mm256_max_pd(a, b)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+#define LANES 2
+typedef __m128d Vector;
+
+#define SPLAT(x) _mm_set1_pd(x)
+#define LOAD(pointer) _mm_loadu_pd(pointer)
+#define STORE(pointer, vector) _mm_storeu_pd(pointer, vector)
+#define ADD(a, b) _mm_add_pd(a, b)
+#define MUL(a, b) _mm_mul_pd(a, b)
+#define MIN(a, b) _mm_min_pd(a, b)
+#define MAX(a, b) _mm_max_pd(a, b)
+#endif
+
+#ifdef LANES
+static double addLanes(Vector vector)
+{
+    double lanes[LANES], sum = 0;
+
+    STORE(lanes, vector);
+
+    for (int i = 0; i < LANES; i++)
+        sum += lanes[i];
+
+    return sum;
+}
+#endif
+
+// two accumulators so consecutive additions don't wait on each other
+double sumDoubles(double *values, size_t count)
+{
+    double sum = 0;
+    size_t i = 0;
+
+#ifdef LANES
+    Vector first = SPLAT(0), second = SPLAT(0);
+
+    for (; i + 2 * LANES <= count; i += 2 * LANES)
+    {
+        first = ADD(first, LOAD(values + i));
+        second = ADD(second, LOAD(values + i + LANES));
+    }
+
+    sum = addLanes(ADD(first, second));
+#endif
+
+    for (; i < count; i++)
+        sum += values[i];
+
+    return sum;
+}
+
+// MIN(a, b) and MAX(a, b) give b when either is NaN, so the loaded values go
+// first to skip NaNs like the comparisons of the scalar loop do
+double minDoubles(double *values, size_t count)
+{
+    double min = values[0];
+    size_t i = 0;
+
+#ifdef LANES
+    Vector lanesMin = SPLAT(min);
+    double lanes[LANES];
+
+    for (; i + LANES <= count; i += LANES)
+        lanesMin = MIN(LOAD(values + i), lanesMin);
+
+    STORE(lanes, lanesMin);
+
+    for (int j = 0; j < LANES; j++)
+        if (lanes[j] < min)
+            min = lanes[j];
+#endif
+
+    for (; i < count; i++)
+        if (values[i] < min)
+            min = values[i];
+
+    return min;
+}
+
+double maxDoubles(double *values, size_t count)
+{
+    double max = values[0];
+    size_t i = 0;
+
+#ifdef LANES
+    Vector lanesMax = SPLAT(max);
+    double lanes[LANES];
+
+    for (; i + LANES <= count; i += LANES)
+        lanesMax = MAX(LOAD(values + i), lanesMax);
+
+    STORE(lanes, lanesMax);
+
+    for (int j = 0; j < LANES; j++)
+        if (lanes[j] > max)
+            max = lanes[j];
+#endif
+
+    for (; i < count; i++)
+        if (values[i] > max)
+            max = values[i];
+
+    return max;
+}
+
+double dotDoubles(double *a, double *b, size_t count)
+{
+    double sum = 0;
+    size_t i = 0;
+
+#ifdef LANES
+    Vector first = SPLAT(0), second = SPLAT(0);
+
+    for (; i + 2 * LANES <= count; i += 2 * LANES)
+    {
+        first = ADD(first, MUL(LOAD(a + i), LOAD(b + i)));
+        second = ADD(second, MUL(LOAD(a + i + LANES), LOAD(b + i + LANES)));
+    }
+
+    sum = addLanes(ADD(first, second));
+#endif
+
+    for (; i < count; i++)
+        sum += a[i] * b[i];
+
+    return sum;
+}
+
+// values *= factor
+void scaleDoubles(double *values, size_t count, double factor)
+{
+    size_t i = 0;
+
+#ifdef LANES
+    Vector factors = SPLAT(factor);
+
+    for (; i + LANES <= count; i += LANES)
+        STORE(values + i, MUL(LOAD(values + i), factors));
+#endif
+
+    for (; i < count; i++)
+        values[i] *= factor;
+}
+
+// y += a * x, it's element-wise so `x` and `y` can be the same
+void axpyDoubles(double *y, double *x, size_t count, double a)
+{
+    size_t i = 0;
+
+#ifdef LANES
+    Vector factors = SPLAT(a);
+
+    for (; i + LANES <= count; i += LANES)
+        STORE(y + i, ADD(MUL(factors, LOAD(x + i)), LOAD(y + i)));
+#endif
+
+    for (; i < count; i++)
+        y[i] += a * x[i];
+}
+
+#ifdef LANES
+#undef LANES
+#undef SPLAT
+#undef LOAD
+#undef STORE
+#undef ADD
+#undef MUL
+#undef MIN
+#undef MAX
+#endif
@@ -0,0 +1,26 @@
+#ifndef clox_simd_h
+#define clox_simd_h
+
+#include "common.h"
+
+/*
+    Kernels over packed doubles, they use AVX when the compiler targets it,
+    SSE2 otherwise (it's always there on x86-64), and plain loops on the
+    rest. Reductions keep several partial sums, so their results can differ
+    from a left to right loop in the last bits.
+*/
+
+double sumDoubles(double *, size_t);
+
+// both need at least one value, NaNs are skipped unless the first value is one
+double minDoubles(double *, size_t);
+
+double maxDoubles(double *, size_t);
+
+double dotDoubles(double *, double *, size_t);
+
+void scaleDoubles(double *, size_t, double);
+
+void axpyDoubles(double *, double *, size_t, double);
+
+#endif
@@ -0,0 +1,793 @@
+#include "snapshot.h"
+#include "serial.h"
+#include "memory.h"
+#include <string.h>
+
+#define NO_REF UINT32_MAX
+
+typedef struct
+{
+    Obj *obj;
+    uint32_t id;
+} Slot;
+
+// the objects of the heap in id order and a pointer -> id lookup
+typedef struct
+{
+    uint32_t count;
+    uint32_t capacity;
+    Obj **objects;
+
+    uint32_t slotsCapacity;
+    Slot *slots;
+} Graph;
+
+static void initGraph(Graph *graph)
+{
+    graph->count = 0;
+    graph->capacity = 0;
+    graph->objects = NULL;
+    graph->slotsCapacity = 0;
+    graph->slots = NULL;
+}
+
+static void freeGraph(Graph *graph)
+{
+    free(graph->objects);
+    free(graph->slots);
+    initGraph(graph);
+}
+
+static Slot *findSlot(Slot *slots, uint32_t capacity, Obj *obj)
+{
+    uint32_t index = (uint32_t)(((uintptr_t)obj >> 3) * 2654435761u) & (capacity - 1);
+
+    while (slots[index].obj != NULL && slots[index].obj != obj)
+        index = (index + 1) & (capacity - 1);
+
+    return &slots[index];
+}
+
+// returns the id of an object, giving it the next one if it doesn't have any
+static uint32_t idOf(Graph *graph, Obj *obj)
+{
+    if (obj == NULL)
+        return NO_REF;
+
+    if ((graph->count + 1) * 2 > graph->slotsCapacity)
+    {
+        uint32_t capacity = GROW_CAPACITY(graph->slotsCapacity);
+        Slot *slots = calloc(capacity, sizeof(Slot));
+
+        for (uint32_t i = 0; i < graph->slotsCapacity; i++)
+            if (graph->slots[i].obj != NULL)
+                *findSlot(slots, capacity, graph->slots[i].obj) = graph->slots[i];
+
+        free(graph->slots);
+        graph->slots = slots;
+        graph->slotsCapacity = capacity;
+    }
+
+    Slot *slot = findSlot(graph->slots, graph->slotsCapacity, obj);
+
+    if (slot->obj != NULL)
+        return slot->id;
+
+    if (graph->count == graph->capacity)
+    {
+        graph->capacity = GROW_CAPACITY(graph->capacity);
+        graph->objects = realloc(graph->objects, graph->capacity * sizeof(Obj *));
+    }
+
+    slot->obj = obj;
+    slot->id = graph->count;
+    graph->objects[graph->count++] = obj;
+
+    return slot->id;
+}
+
+static void discoverValue(Graph *graph, Value value)
+{
+    if (IS_OBJ(value))
+        idOf(graph, AS_OBJ(value));
+}
+
+static void discoverHashMap(Graph *graph, HashMap *hashMap)
+{
+    int i = 0;
+    Entry *entry;
+
+    while ((entry = hashMapNext(hashMap, &i)) != NULL)
+    {
+        idOf(graph, (Obj *)entry->key);
+        discoverValue(graph, entry->value);
+    }
+}
+
+// walks the heap the same way the GC does (see `blankenObj`)
+static void discoverReferences(Graph *graph, Obj *obj)
+{
+    switch (obj->type)
+    {
+    case OBJ_STRING:
+        // ropes are written flat, so their children aren't needed
+        flattenString((ObjString *)obj);
+        break;
+    case OBJ_FUNCTION:
+    {
+        ObjFunction *function = (ObjFunction *)obj;
+
+        idOf(graph, (Obj *)function->name);
+
+        for (size_t i = 0; i < function->chunk.constants.count; i++)
+            discoverValue(graph, function->chunk.constants.values[i]);
+
+        break;
+    }
+    case OBJ_CLOSURE:
+    {
+        ObjClosure *closure = (ObjClosure *)obj;
+
+        idOf(graph, (Obj *)closure->function);
+
+        for (int i = 0; i < closure->upValuesCount; i++)
+            idOf(graph, (Obj *)closure->upValues[i]);
+
+        break;
+    }
+    case OBJ_UPVALUE:
+        discoverValue(graph, *((ObjUpValue *)obj)->location);
+        break;
+    case OBJ_CLASS:
+    {
+        ObjClass *klass = (ObjClass *)obj;
+
+        idOf(graph, (Obj *)klass->name);
+        idOf(graph, (Obj *)klass->superclass);
+        idOf(graph, (Obj *)klass->initializer);
+        discoverHashMap(graph, &klass->methods);
+
+        break;
+    }
+    case OBJ_INSTANCE:
+    {
+        ObjInstance *instance = (ObjInstance *)obj;
+
+        idOf(graph, (Obj *)instance->klass);
+        discoverHashMap(graph, &instance->fields);
+
+        break;
+    }
+    case OBJ_BOUND_METHOD:
+    {
+        ObjBoundMethod *boundMethod = (ObjBoundMethod *)obj;
+
+        idOf(graph, (Obj *)boundMethod->instance);
+        idOf(graph, (Obj *)boundMethod->method);
+
+        break;
+    }
+    case OBJ_LIST:
+    {
+        ObjList *list = (ObjList *)obj;
+
+        for (size_t i = 0; i < list->items.count; i++)
+            discoverValue(graph, list->items.values[i]);
+
+        break;
+    }
+    case OBJ_MAP:
+    {
+        int index = 0;
+        MapEntry *entry;
+
+        while ((entry = valueMapNext(&((ObjMap *)obj)->entries, &index)) != NULL)
+        {
+            discoverValue(graph, entry->key);
+            discoverValue(graph, entry->value);
+        }
+
+        break;
+    }
+    default:;
+    }
+}
+
+//> WRITING
+static void writeRef(Writer *writer, Graph *graph, Obj *obj)
+{
+    writeU32(writer, obj == NULL ? NO_REF : findSlot(graph->slots, graph->slotsCapacity, obj)->id);
+}
+
+static void writeValue(Writer *writer, Graph *graph, Value value)
+{
+    writeU8(writer, value.type);
+
+    switch (value.type)
+    {
+    case VAL_BOOL:
+        writeU8(writer, AS_BOOL(value));
+        break;
+    case VAL_NIL:
+        break;
+    case VAL_NUMBER:
+        writeDouble(writer, AS_NUMBER(value));
+        break;
+    case VAL_OBJ:
+        writeRef(writer, graph, AS_OBJ(value));
+        break;
+    }
+}
+
+static void writeHashMap(Writer *writer, Graph *graph, HashMap *hashMap)
+{
+    int i = 0;
+    Entry *entry;
+
+    writeU32(writer, hashMap->count);
+
+    while ((entry = hashMapNext(hashMap, &i)) != NULL)
+    {
+        writeRef(writer, graph, (Obj *)entry->key);
+        writeValue(writer, graph, entry->value);
+    }
+}
+
+static void writeShell(Writer *writer, Graph *graph, Obj *obj)
+{
+    writeU8(writer, obj->type);
+
+    switch (obj->type)
+    {
+    case OBJ_STRING:
+    {
+        ObjString *string = (ObjString *)obj;
+
+        writeU32(writer, string->length);
+        writeBytes(writer, STRING_CHARS(string), string->length);
+        break;
+    }
+    case OBJ_FUNCTION:
+        writeRef(writer, graph, (Obj *)((ObjFunction *)obj)->name);
+        break;
+    case OBJ_NATIVE:
+    {
+        NativeDef *native = findNativeByFunction(((ObjNative *)obj)->function);
+        char *name = native != NULL ? native->name : "";
+
+        writeU32(writer, strlen(name));
+        writeBytes(writer, name, strlen(name));
+        break;
+    }
+    case OBJ_CLOSURE:
+    {
+        ObjClosure *closure = (ObjClosure *)obj;
+
+        writeRef(writer, graph, (Obj *)closure->function);
+        writeU8(writer, closure->upValuesCount);
+        break;
+    }
+    case OBJ_CLASS:
+        writeRef(writer, graph, (Obj *)((ObjClass *)obj)->name);
+        break;
+    case OBJ_INSTANCE:
+        writeRef(writer, graph, (Obj *)((ObjInstance *)obj)->klass);
+        break;
+    case OBJ_BOUND_METHOD:
+    {
+        ObjBoundMethod *boundMethod = (ObjBoundMethod *)obj;
+
+        writeRef(writer, graph, (Obj *)boundMethod->instance);
+        writeRef(writer, graph, (Obj *)boundMethod->method);
+        break;
+    }
+    case OBJ_LIST:
+        writeU32(writer, ((ObjList *)obj)->items.count);
+        break;
+    case OBJ_FLOAT_ARRAY:
+    {
+        ObjFloatArray *array = (ObjFloatArray *)obj;
+
+        // it has no references so all of it goes in the shell
+        writeU32(writer, array->length);
+
+        for (size_t i = 0; i < array->length; i++)
+            writeDouble(writer, array->values[i]);
+
+        break;
+    }
+    default:;
+    }
+}
+
+static void writeBody(Writer *writer, Graph *graph, Obj *obj)
+{
+    switch (obj->type)
+    {
+    case OBJ_FUNCTION:
+    {
+        ObjFunction *function = (ObjFunction *)obj;
+        Chunk *chunk = &function->chunk;
+
+        writeU8(writer, function->arity);
+
+        writeU32(writer, chunk->count);
+        writeBytes(writer, chunk->code, chunk->count);
+
+        writeU32(writer, chunk->positions.count);
+        writeBytes(writer, chunk->positions.bytes, chunk->positions.count);
+
+        writeU32(writer, chunk->constants.count);
+        for (size_t i = 0; i < chunk->constants.count; i++)
+            writeValue(writer, graph, chunk->constants.values[i]);
+
+        break;
+    }
+    case OBJ_CLOSURE:
+    {
+        ObjClosure *closure = (ObjClosure *)obj;
+
+        for (int i = 0; i < closure->upValuesCount; i++)
+            writeRef(writer, graph, (Obj *)closure->upValues[i]);
+
+        break;
+    }
+    case OBJ_UPVALUE:
+        writeValue(writer, graph, *((ObjUpValue *)obj)->location);
+        break;
+    case OBJ_CLASS:
+    {
+        ObjClass *klass = (ObjClass *)obj;
+
+        writeRef(writer, graph, (Obj *)klass->superclass);
+        writeRef(writer, graph, (Obj *)klass->initializer);
+        writeHashMap(writer, graph, &klass->methods);
+        break;
+    }
+    case OBJ_INSTANCE:
+        writeHashMap(writer, graph, &((ObjInstance *)obj)->fields);
+        break;
+    case OBJ_LIST:
+    {
+        ObjList *list = (ObjList *)obj;
+
+        for (size_t i = 0; i < list->items.count; i++)
+            writeValue(writer, graph, list->items.values[i]);
+
+        break;
+    }
+    case OBJ_MAP:
+    {
+        ValueMap *entries = &((ObjMap *)obj)->entries;
+        int index = 0;
+        MapEntry *entry;
+
+        writeU32(writer, entries->count);
+
+        while ((entry = valueMapNext(entries, &index)) != NULL)
+        {
+            writeValue(writer, graph, entry->key);
+            writeValue(writer, graph, entry->value);
+        }
+
+        break;
+    }
+    default:;
+    }
+}
+
+// writes everything reachable from the globals and the interned strings,
+// `source` is the prelude that the functions of the heap were compiled from
+bool writeSnapshot(char *path, char *source)
+{
+    Graph graph;
+    initGraph(&graph);
+
+    discoverHashMap(&graph, &vm.strings);
+    discoverHashMap(&graph, &vm.globals);
+
+    for (uint32_t i = 0; i < graph.count; i++)
+        discoverReferences(&graph, graph.objects[i]);
+
+    // renumber the objects by type
+    Graph ordered;
+    initGraph(&ordered);
+
+    for (ObjType type = OBJ_STRING; type <= OBJ_FILE; type++)
+        for (uint32_t i = 0; i < graph.count; i++)
+            if (graph.objects[i]->type == type)
+                idOf(&ordered, graph.objects[i]);
+
+    freeGraph(&graph);
+
+    Writer writer;
+    size_t sourceLength = strlen(source);
+
+    initWriter(&writer);
+
+    writeBytes(&writer, SNAPSHOT_MAGIC, strlen(SNAPSHOT_MAGIC));
+    writeU32(&writer, SNAPSHOT_VERSION);
+    writeU32(&writer, sourceLength);
+    writeBytes(&writer, source, sourceLength);
+
+    writeU32(&writer, ordered.count);
+
+    for (uint32_t i = 0; i < ordered.count; i++)
+        writeShell(&writer, &ordered, ordered.objects[i]);
+
+    for (uint32_t i = 0; i < ordered.count; i++)
+        writeBody(&writer, &ordered, ordered.objects[i]);
+
+    writeHashMap(&writer, &ordered, &vm.globals);
+
+    bool written = writeToFile(&writer, path);
+
+    freeWriter(&writer);
+    freeGraph(&ordered);
+
+    return written;
+}
+//<
+
+//> RESTORING
+typedef struct
+{
+    Reader reader;
+    uint32_t count;
+    uint32_t restored; // the number of shells that got allocated so far
+    Obj **objects;
+    char *source;
+    size_t sourceLength;
+} Restorer;
+
+// returns the object of an id, checking that it exists and has the expected type
+static Obj *readRef(Restorer *restorer, int type)
+{
+    uint32_t id = readU32(&restorer->reader);
+
+    if (id == NO_REF)
+        return NULL;
+
+    if (id >= restorer->restored || (type != -1 && restorer->objects[id]->type != type))
+    {
+        restorer->reader.failed = true;
+        return NULL;
+    }
+
+    return restorer->objects[id];
+}
+
+static Value readValue(Restorer *restorer)
+{
+    switch (readU8(&restorer->reader))
+    {
+    case VAL_BOOL:
+        return BOOL(readU8(&restorer->reader));
+    case VAL_NIL:
+        return NIL;
+    case VAL_NUMBER:
+        return NUMBER(readDouble(&restorer->reader));
+    case VAL_OBJ:
+    {
+        Obj *obj = readRef(restorer, -1);
+
+        if (obj != NULL)
+            return OBJ(obj);
+    }
+    default:
+        restorer->reader.failed = true;
+        return NIL;
+    }
+}
+
+static void readHashMap(Restorer *restorer, HashMap *hashMap)
+{
+    uint32_t count = readU32(&restorer->reader);
+
+    for (uint32_t i = 0; i < count && !restorer->reader.failed; i++)
+    {
+        ObjString *key = (ObjString *)readRef(restorer, OBJ_STRING);
+        Value value = readValue(restorer);
+
+        if (key != NULL)
+            hashMapInsert(hashMap, key, value);
+        else
+            restorer->reader.failed = true;
+    }
+}
+
+static Obj *readShell(Restorer *restorer)
+{
+    Reader *reader = &restorer->reader;
+
+    switch (readU8(reader))
+    {
+    case OBJ_STRING:
+    {
+        uint32_t length = readU32(reader);
+        char *chars = readBytes(reader, length);
+
+        return chars == NULL ? NULL : (Obj *)allocateObjString(chars, length);
+    }
+    case OBJ_FUNCTION:
+    {
+        ObjString *name = (ObjString *)readRef(restorer, OBJ_STRING);
+        ObjFunction *function = allocateObjFunction();
+
+        function->name = name;
+        return (Obj *)function;
+    }
+    case OBJ_NATIVE:
+    {
+        uint32_t length = readU32(reader);
+        char *name = readBytes(reader, length);
+        NativeDef *native = name == NULL ? NULL : findNativeByName(name, length);
+
+        return native == NULL ? NULL : (Obj *)allocateObjNative(native->minArity, native->arity, native->function);
+    }
+    case OBJ_CLOSURE:
+    {
+        ObjFunction *function = (ObjFunction *)readRef(restorer, OBJ_FUNCTION);
+        uint8_t upValuesCount = readU8(reader);
+
+        return function == NULL ? NULL : (Obj *)allocateObjClosure(function, upValuesCount);
+    }
+    case OBJ_UPVALUE:
+    {
+        ObjUpValue *upValue = allocateObjUpValue(NULL);
+
+        upValue->location = &upValue->closed;
+        return (Obj *)upValue;
+    }
+    case OBJ_CLASS:
+    {
+        ObjString *name = (ObjString *)readRef(restorer, OBJ_STRING);
+
+        return name == NULL ? NULL : (Obj *)allocateObjClass(name);
+    }
+    case OBJ_INSTANCE:
+    {
+        ObjClass *klass = (ObjClass *)readRef(restorer, OBJ_CLASS);
+
+        return klass == NULL ? NULL : (Obj *)allocateObjInstance(klass);
+    }
+    case OBJ_BOUND_METHOD:
+    {
+        ObjInstance *instance = (ObjInstance *)readRef(restorer, OBJ_INSTANCE);
+        ObjClosure *method = (ObjClosure *)readRef(restorer, OBJ_CLOSURE);
+
+        return instance == NULL || method == NULL ? NULL : (Obj *)allocateObjBoundMethod(instance, method);
+    }
+    case OBJ_LIST:
+    {
+        uint32_t count = readU32(reader);
+
+        // the count is checked against what's left so a bad one can't allocate too much
+        if (reader->failed || count > (size_t)(reader->end - reader->current))
+            return NULL;
+
+        return (Obj *)allocateObjList(count);
+    }
+    case OBJ_MAP:
+        return (Obj *)allocateObjMap();
+    case OBJ_FLOAT_ARRAY:
+    {
+        uint32_t length = readU32(reader);
+
+        if (reader->failed || length > (size_t)(reader->end - reader->current) / sizeof(double))
+            return NULL;
+
+        ObjFloatArray *array = allocateObjFloatArray(length);
+
+        for (uint32_t i = 0; i < length; i++)
+            array->values[i] = readDouble(reader);
+
+        return (Obj *)array;
+    }
+    // the descriptor means nothing in another process
+    case OBJ_FILE:
+        return (Obj *)allocateObjFile(-1);
+    default:
+        return NULL;
+    }
+}
+
+static void readBody(Restorer *restorer, Obj *obj)
+{
+    Reader *reader = &restorer->reader;
+
+    switch (obj->type)
+    {
+    case OBJ_FUNCTION:
+    {
+        ObjFunction *function = (ObjFunction *)obj;
+        Chunk *chunk = &function->chunk;
+
+        function->arity = readU8(reader);
+
+        uint32_t count = readU32(reader);
+        uint8_t *code = readBytes(reader, count);
+
+        if (code == NULL)
+            return;
+
+        chunk->code = ALLOCATE(uint8_t, count);
+        memcpy(chunk->code, code, count);
+        chunk->count = chunk->capacity = count;
+
+        count = readU32(reader);
+        uint8_t *positions = readBytes(reader, count);
+
+        if (positions == NULL)
+            return;
+
+        chunk->positions.bytes = ALLOCATE(uint8_t, count);
+        memcpy(chunk->positions.bytes, positions, count);
+        chunk->positions.count = chunk->positions.capacity = count;
+        chunk->source = restorer->source;
+
+        count = readU32(reader);
+
+        // every constant takes at least its tag byte, so a bigger count is corrupt
+        if (reader->failed || count > (size_t)(reader->end - reader->current))
+        {
+            reader->failed = true;
+            return;
+        }
+
+        chunk->constants.values = ALLOCATE(Value, count);
+        chunk->constants.capacity = count;
+
+        for (uint32_t i = 0; i < count; i++)
+            chunk->constants.values[chunk->constants.count++] = readValue(restorer);
+
+        break;
+    }
+    case OBJ_CLOSURE:
+    {
+        ObjClosure *closure = (ObjClosure *)obj;
+
+        for (int i = 0; i < closure->upValuesCount; i++)
+            closure->upValues[i] = (ObjUpValue *)readRef(restorer, OBJ_UPVALUE);
+
+        break;
+    }
+    case OBJ_UPVALUE:
+        ((ObjUpValue *)obj)->closed = readValue(restorer);
+        break;
+    case OBJ_CLASS:
+    {
+        ObjClass *klass = (ObjClass *)obj;
+
+        klass->superclass = (ObjClass *)readRef(restorer, OBJ_CLASS);
+        klass->initializer = (ObjClosure *)readRef(restorer, OBJ_CLOSURE);
+        readHashMap(restorer, &klass->methods);
+        break;
+    }
+    case OBJ_INSTANCE:
+        readHashMap(restorer, &((ObjInstance *)obj)->fields);
+        break;
+    case OBJ_LIST:
+    {
+        ValueArr *items = &((ObjList *)obj)->items;
+
+        while (items->count < items->capacity && !reader->failed)
+            items->values[items->count++] = readValue(restorer);
+
+        break;
+    }
+    case OBJ_MAP:
+    {
+        uint32_t count = readU32(reader);
+
+        // the keys hash with this vm's seed, so they're inserted again
+        for (uint32_t i = 0; i < count && !reader->failed; i++)
+        {
+            Value key = readValue(restorer);
+            Value value = readValue(restorer);
+
+            valueMapSet(&((ObjMap *)obj)->entries, key, value);
+        }
+
+        break;
+    }
+    default:;
+    }
+}
+
+// loads a snapshot into the (freshly initialized) vm, `source` receives the prelude
+// that position tables point to and it should stay alive as long as the vm does
+bool restoreSnapshot(char *path, char **source)
+{
+    size_t size;
+    uint8_t *bytes = mapFile(path, &size);
+
+    if (bytes == NULL)
+        return false;
+
+    Restorer restorer;
+    Reader *reader = &restorer.reader;
+
+    reader->current = bytes;
+    reader->end = bytes + size;
+    reader->failed = false;
+
+    char *magic = readBytes(reader, strlen(SNAPSHOT_MAGIC));
+    uint32_t version = readU32(reader);
+
+    if (reader->failed || memcmp(magic, SNAPSHOT_MAGIC, strlen(SNAPSHOT_MAGIC)) != 0 || version != SNAPSHOT_VERSION)
+    {
+        unmapFile(bytes, size);
+        return false;
+    }
+
+    restorer.sourceLength = readU32(reader);
+    char *sourceBytes = readBytes(reader, restorer.sourceLength);
+
+    // readBytes already checked the length against the mapped size
+    restorer.source = sourceBytes == NULL ? NULL : malloc(restorer.sourceLength + 1);
+
+    if (restorer.source == NULL)
+    {
+        unmapFile(bytes, size);
+        return false;
+    }
+
+    memcpy(restorer.source, sourceBytes, restorer.sourceLength);
+    restorer.source[restorer.sourceLength] = '\0';
+
+    restorer.count = readU32(reader);
+    restorer.restored = 0;
+
+    // every object takes at least its tag byte, so a bigger count is corrupt
+    if (reader->failed || restorer.count > (size_t)(reader->end - reader->current))
+    {
+        free(restorer.source);
+        unmapFile(bytes, size);
+        return false;
+    }
+
+    restorer.objects = malloc(sizeof(Obj *) * restorer.count);
+
+    if (restorer.objects == NULL && restorer.count > 0)
+    {
+        free(restorer.source);
+        unmapFile(bytes, size);
+        return false;
+    }
+
+    // nothing is reachable before the globals are restored
+    vm.deferGc++;
+
+    while (!reader->failed && restorer.restored < restorer.count)
+    {
+        Obj *obj = readShell(&restorer);
+
+        if (obj == NULL)
+            reader->failed = true;
+        else
+            restorer.objects[restorer.restored++] = obj;
+    }
+
+    for (uint32_t i = 0; i < restorer.restored && !reader->failed; i++)
+        readBody(&restorer, restorer.objects[i]);
+
+    if (!reader->failed)
+        readHashMap(&restorer, &vm.globals);
+
+    vm.deferGc--;
+
+    free(restorer.objects);
+    unmapFile(bytes, size);
+
+    if (reader->failed)
+    {
+        free(restorer.source);
+        return false;
+    }
+
+    *source = restorer.source;
+
+    return true;
+}
+//<
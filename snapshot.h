@@ -0,0 +1,24 @@
+#ifndef clox_snapshot_h
+#define clox_snapshot_h
+
+#include "common.h"
+
+#define SNAPSHOT_MAGIC "LOXS"
+#define SNAPSHOT_VERSION 3
+
+/*
+    A snapshot is a relocatable copy of the heap after running a prelude,
+    objects refer to each other by ids that get fixed up to pointers when
+    it's restored, its layout is:
+        * header: magic, version, and the prelude's source (for position tables)
+        * shells: every object's type and the data needed to allocate it,
+          ordered by type so they only refer to objects that come before them
+        * bodies: the rest of the references of every object
+        * globals
+*/
+
+bool writeSnapshot(char *, char *);
+
+bool restoreSnapshot(char *, char **);
+
+#endif
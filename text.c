@@ -0,0 +1,300 @@
+#include "text.h"
+#include "memory.h"
+#include "list.h"
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+//> HELPERS
+static bool checkString(Value value)
+{
+    if (!IS_STRING(value))
+    {
+        runtimeError("The argument should be a string");
+        return false;
+    }
+
+    return true;
+}
+
+// nil gives the fallback, NaN counts as 0, negative indices count from the
+// end, and the rest get clamped to the string
+static bool readIndex(Value value, size_t length, size_t fallback, size_t *index)
+{
+    if (IS_NIL(value))
+    {
+        *index = fallback;
+        return true;
+    }
+
+    if (!IS_NUMBER(value))
+    {
+        runtimeError("The index should be a number");
+        return false;
+    }
+
+    double number = AS_NUMBER(value);
+
+    // NaN fails every comparison below, so it is read as 0 instead
+    if (number != number)
+        number = 0;
+
+    if (number < 0)
+        number += length;
+
+    *index = number < 0 ? 0 : number > length ? length : (size_t)number;
+    return true;
+}
+
+// memchr jumps to the candidates for the first character (it's vectorized by libc)
+static char *findSubstring(char *haystack, size_t haystackLength, char *needle, size_t needleLength)
+{
+    if (needleLength == 0)
+        return haystack;
+
+    char *current = haystack;
+    char *end = haystack + haystackLength;
+
+    while ((size_t)(end - current) >= needleLength)
+    {
+        current = memchr(current, needle[0], end - current - needleLength + 1);
+
+        if (current == NULL)
+            return NULL;
+
+        if (memcmp(current + 1, needle + 1, needleLength - 1) == 0)
+            return current;
+
+        current++;
+    }
+
+    return NULL;
+}
+//<
+
+//> METHODS
+static bool stringIndexOf(Value *returnValue, Value *args)
+{
+    if (!checkString(args[1]))
+        return false;
+
+    ObjString *string = AS_STRING(args[0]);
+    ObjString *needle = AS_STRING(args[1]);
+    size_t from;
+
+    if (!readIndex(args[2], string->length, 0, &from))
+        return false;
+
+    char *chars = flattenString(string);
+    char *found = findSubstring(chars + from, string->length - from, flattenString(needle), needle->length);
+
+    *returnValue = NUMBER(found != NULL ? (double)(found - chars) : -1);
+    return true;
+}
+
+static bool stringReplace(Value *returnValue, Value *args)
+{
+    if (!checkString(args[1]) || !checkString(args[2]))
+        return false;
+
+    ObjString *string = AS_STRING(args[0]);
+    ObjString *needle = AS_STRING(args[1]);
+    ObjString *replacement = AS_STRING(args[2]);
+
+    if (needle->length == 0)
+    {
+        runtimeError("The replaced string can't be empty");
+        return false;
+    }
+
+    char *chars = flattenString(string), *end = chars + string->length;
+    char *current = chars;
+    size_t count = 0;
+
+    while ((current = findSubstring(current, end - current, flattenString(needle), needle->length)) != NULL)
+    {
+        count++;
+        current += needle->length;
+    }
+
+    if (count == 0)
+    {
+        *returnValue = args[0];
+        return true;
+    }
+
+    size_t length = string->length - count * needle->length + count * replacement->length;
+
+    if (length > INT_MAX)
+    {
+        runtimeError("The result is too long");
+        return false;
+    }
+
+    ObjString *result = reserveObjString(length);
+
+    // reserving could've compacted views
+    chars = flattenString(string), end = chars + string->length;
+    current = chars;
+    char *target = result->chars;
+    char *found;
+
+    while ((found = findSubstring(current, end - current, flattenString(needle), needle->length)) != NULL)
+    {
+        memcpy(target, current, found - current);
+        target += found - current;
+        memcpy(target, flattenString(replacement), replacement->length);
+        target += replacement->length;
+        current = found + needle->length;
+    }
+
+    memcpy(target, current, end - current);
+
+    *returnValue = OBJ(trackObjString(result));
+    return true;
+}
+
+static bool stringSlice(Value *returnValue, Value *args)
+{
+    ObjString *string = AS_STRING(args[0]);
+    size_t start, end;
+
+    if (!readIndex(args[1], string->length, 0, &start) || !readIndex(args[2], string->length, string->length, &end))
+        return false;
+
+    if (end < start)
+        end = start;
+
+    *returnValue = OBJ(allocateObjView(string, start, end - start));
+    return true;
+}
+
+static bool stringStartsWith(Value *returnValue, Value *args)
+{
+    if (!checkString(args[1]))
+        return false;
+
+    ObjString *string = AS_STRING(args[0]);
+    ObjString *prefix = AS_STRING(args[1]);
+
+    *returnValue = BOOL(prefix->length <= string->length && memcmp(flattenString(string), flattenString(prefix), prefix->length) == 0);
+    return true;
+}
+
+static bool stringTrim(Value *returnValue, Value *args)
+{
+    ObjString *string = AS_STRING(args[0]);
+    char *chars = flattenString(string);
+    size_t start = 0, end = string->length;
+
+    while (start < end && isspace((unsigned char)chars[start]))
+        start++;
+
+    while (end > start && isspace((unsigned char)chars[end - 1]))
+        end--;
+
+    *returnValue = OBJ(allocateObjView(string, start, end - start));
+    return true;
+}
+
+static Value mapCharacters(ObjString *string, int (*map)(int))
+{
+    ObjString *result = reserveObjString(string->length);
+    char *chars = flattenString(string);
+
+    for (size_t i = 0; i < string->length; i++)
+        result->chars[i] = map((unsigned char)chars[i]);
+
+    return OBJ(trackObjString(result));
+}
+
+static bool stringUpper(Value *returnValue, Value *args)
+{
+    *returnValue = mapCharacters(AS_STRING(args[0]), toupper);
+    return true;
+}
+
+static bool stringLower(Value *returnValue, Value *args)
+{
+    *returnValue = mapCharacters(AS_STRING(args[0]), tolower);
+    return true;
+}
+
+// an empty separator splits the string into its characters, the parts are
+// views (or copies when they're short) of the string
+static bool stringSplit(Value *returnValue, Value *args)
+{
+    if (!checkString(args[1]))
+        return false;
+
+    ObjString *string = AS_STRING(args[0]);
+    ObjString *separator = AS_STRING(args[1]);
+    ObjList *list = allocateObjList(0);
+    size_t start = 0;
+
+    push(OBJ(list));
+
+    if (separator->length == 0)
+    {
+        for (; start < string->length; start++)
+            appendToList(list, OBJ(allocateObjView(string, start, 1)));
+
+        *returnValue = pop();
+        return true;
+    }
+
+    while (true)
+    {
+        // allocating could've compacted the string if it's a view
+        char *chars = flattenString(string);
+        char *found = findSubstring(chars + start, string->length - start, flattenString(separator), separator->length);
+        size_t end = found != NULL ? (size_t)(found - chars) : string->length;
+
+        appendToList(list, OBJ(allocateObjView(string, start, end - start)));
+
+        if (found == NULL)
+            break;
+
+        start = end + separator->length;
+    }
+
+    *returnValue = pop();
+    return true;
+}
+
+// returns nil for indices outside of the string
+static bool stringCharCodeAt(Value *returnValue, Value *args)
+{
+    ObjString *string = AS_STRING(args[0]);
+
+    if (!IS_NUMBER(args[1]))
+    {
+        runtimeError("The index should be a number");
+        return false;
+    }
+
+    double index = AS_NUMBER(args[1]);
+
+    // NaN is out of range too
+    if (!(index >= 0 && index < string->length))
+        *returnValue = NIL;
+    else
+        *returnValue = NUMBER((uint8_t)flattenString(string)[(size_t)index]);
+
+    return true;
+}
+
+NativeDef stringMethods[] = {
+    {"indexOf", (NativeFun)stringIndexOf, 1, 2},
+    {"replace", (NativeFun)stringReplace, 2, 2},
+    {"slice", (NativeFun)stringSlice, 1, 2},
+    {"startsWith", (NativeFun)stringStartsWith, 1, 1},
+    {"trim", (NativeFun)stringTrim, 0, 0},
+    {"upper", (NativeFun)stringUpper, 0, 0},
+    {"lower", (NativeFun)stringLower, 0, 0},
+    {"charCodeAt", (NativeFun)stringCharCodeAt, 1, 1},
+    {"split", (NativeFun)stringSplit, 1, 1},
+};
+
+int stringMethodsCount = sizeof(stringMethods) / sizeof(NativeDef);
+//<
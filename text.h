@@ -0,0 +1,12 @@
+#ifndef clox_text_h
+#define clox_text_h
+
+#include "common.h"
+#include "vm.h"
+
+// methods of strings, they get the string they're called on in `args[0]`
+extern NativeDef stringMethods[];
+
+extern int stringMethodsCount;
+
+#endif
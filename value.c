@@ -1,5 +1,6 @@
 #include "value.h"
 #include "memory.h"
+#include "number.h"
 #include <string.h>
 
 bool isTruthy(Value value)
@@ -17,53 +18,85 @@ bool isTruthy(Value value)
     }
 }
 
+// the lists and maps being printed, the ones that contain themselves (or are
+// nested too deep) are printed as `[...]` or `{...}` instead of recursing
+#define PRINT_MAX_DEPTH 64
+static Obj *printing[PRINT_MAX_DEPTH];
+static int printingCount = 0;
+
+static bool startPrinting(Obj *obj)
+{
+    if (printingCount == PRINT_MAX_DEPTH)
+        return false;
+
+    for (int i = 0; i < printingCount; i++)
+    {
+        if (printing[i] == obj)
+            return false;
+    }
+
+    printing[printingCount++] = obj;
+    return true;
+}
+
 #define TAB_SIZE 4
 void printValue(Value value)
 {
     switch (value.type)
     {
     case VAL_BOOL:
-        printf("%s", AS_BOOL(value) ? "true" : "false");
+        writeOutputString(&vm.output, AS_BOOL(value) ? "true" : "false");
         break;
     case VAL_NIL:
-        printf("nil");
+        writeOutputString(&vm.output, "nil");
         break;
     case VAL_NUMBER:
-        printf("%g", AS_NUMBER(value));
+    {
+        char buffer[NUMBER_BUFFER_SIZE];
+
+        int length = formatNumber(AS_NUMBER(value), buffer);
+        writeOutput(&vm.output, buffer, length);
         break;
+    }
     case VAL_OBJ:
         switch (AS_OBJ(value)->type)
         {
         case OBJ_STRING:
-            printf("%s", AS_STRING(value)->chars);
+        {
+            ObjString *string = AS_STRING(value);
+
+            writeOutput(&vm.output, flattenString(string), string->length);
             break;
+        }
         case OBJ_FUNCTION:
         {
             ObjString *name = AS_FUNCTION(value)->name;
 
             if (name != NULL)
             {
-                printf("<fun %s>", name->chars);
+                writeOutputString(&vm.output, "<fun ");
+                writeOutput(&vm.output, name->chars, name->length);
+                writeOutputChar(&vm.output, '>');
             }
             else
             {
-                printf("<anonymous fun>");
+                writeOutputString(&vm.output, "<anonymous fun>");
             }
 
             break;
         }
         case OBJ_NATIVE:
-            printf("<native fun>");
+            writeOutputString(&vm.output, "<native fun>");
             break;
         case OBJ_CLOSURE:
 #ifdef DEBUG_WRAPPERS
-            printf("Closure -> ");
+            writeOutputString(&vm.output, "Closure -> ");
 #endif
             printValue(OBJ(AS_CLOSURE(value)->function));
             break;
         case OBJ_UPVALUE:
 #ifdef DEBUG_WRAPPERS
-            printf("UpValue -> ");
+            writeOutputString(&vm.output, "UpValue -> ");
 #endif
             printValue(*AS_UPVALUE(value)->location);
             break;
@@ -71,7 +104,9 @@ void printValue(Value value)
         {
             ObjClass *klass = AS_CLASS(value);
 
-            printf("<class %s>", klass->name->chars);
+            writeOutputString(&vm.output, "<class ");
+            writeOutput(&vm.output, klass->name->chars, klass->name->length);
+            writeOutputChar(&vm.output, '>');
             break;
         }
         case OBJ_INSTANCE:
@@ -79,31 +114,105 @@ void printValue(Value value)
             ObjInstance *instance = AS_INSTANCE(value);
             HashMap fields = instance->fields;
 
-            printf("<instanceof %s> {%s", instance->klass->name->chars, instance->fields.count > 0 ? "\n" : "");
-            for (int i = 0; i < fields.capacity; i++)
-            {
-                Entry *entry = &fields.entries[i];
-
-                if (entry->key == NULL || entry->isTombstone)
-                    continue;
+            writeOutputString(&vm.output, "<instanceof ");
+            writeOutput(&vm.output, instance->klass->name->chars, instance->klass->name->length);
+            writeOutputString(&vm.output, instance->fields.count > 0 ? "> {\n" : "> {");
+            int index = 0;
+            Entry *entry;
 
-                for (int i = 0; i < TAB_SIZE; i++)
-                    putchar(' ');
+            while ((entry = hashMapNext(&fields, &index)) != NULL)
+            {
+                writeOutput(&vm.output, "    ", TAB_SIZE);
 
                 printValue(OBJ(entry->key));
-                printf(": ");
+                writeOutputString(&vm.output, ": ");
                 printValue(entry->value);
-                printf(",\n");
+                writeOutputString(&vm.output, ",\n");
             }
-            putchar('}');
+            writeOutputChar(&vm.output, '}');
             break;
         }
         case OBJ_BOUND_METHOD:
 #ifdef DEBUG_WRAPPERS
-            printf("BoundMethod -> ");
+            writeOutputString(&vm.output, "BoundMethod -> ");
 #endif
             printValue(OBJ(AS_BOUND_METHOD(value)->method->function));
             break;
+        case OBJ_LIST:
+        {
+            ValueArr *items = &AS_LIST(value)->items;
+
+            if (!startPrinting(AS_OBJ(value)))
+            {
+                writeOutputString(&vm.output, "[...]");
+                break;
+            }
+
+            writeOutputChar(&vm.output, '[');
+
+            for (size_t i = 0; i < items->count; i++)
+            {
+                if (i > 0)
+                    writeOutputString(&vm.output, ", ");
+
+                printValue(items->values[i]);
+            }
+
+            writeOutputChar(&vm.output, ']');
+            printingCount--;
+            break;
+        }
+        case OBJ_MAP:
+        {
+            ValueMap *entries = &AS_MAP(value)->entries;
+            int index = 0;
+            MapEntry *entry;
+            bool first = true;
+
+            if (!startPrinting(AS_OBJ(value)))
+            {
+                writeOutputString(&vm.output, "{...}");
+                break;
+            }
+
+            writeOutputChar(&vm.output, '{');
+
+            while ((entry = valueMapNext(entries, &index)) != NULL)
+            {
+                if (!first)
+                    writeOutputString(&vm.output, ", ");
+
+                first = false;
+
+                printValue(entry->key);
+                writeOutputString(&vm.output, ": ");
+                printValue(entry->value);
+            }
+
+            writeOutputChar(&vm.output, '}');
+            printingCount--;
+            break;
+        }
+        case OBJ_FLOAT_ARRAY:
+        {
+            ObjFloatArray *array = AS_FLOAT_ARRAY(value);
+
+            writeOutputString(&vm.output, "Float64Array [");
+
+            for (size_t i = 0; i < array->length; i++)
+            {
+                if (i > 0)
+                    writeOutputString(&vm.output, ", ");
+
+                printValue(NUMBER(array->values[i]));
+            }
+
+            writeOutputChar(&vm.output, ']');
+            break;
+        }
+        case OBJ_FILE:
+            writeOutputString(&vm.output, AS_FILE(value)->fd == -1 ? "<closed file>" : "<file>");
+            break;
         }
     default:;
     }
@@ -123,6 +232,9 @@ bool equal(Value a, Value b)
     case VAL_NUMBER:
         return AS_NUMBER(a) == AS_NUMBER(b);
     case VAL_OBJ:
+        if (IS_STRING(a) && IS_STRING(b))
+            return equalStrings(AS_STRING(a), AS_STRING(b));
+
         return AS_OBJ(a) == AS_OBJ(b);
     }
 
@@ -0,0 +1,239 @@
+#include "valuemap.h"
+#include "memory.h"
+#include <math.h>
+#include <string.h>
+
+#define EMPTY_SLOT -1
+
+// the index stays at most half full so probes are short
+#define INDEX_SIZE(capacity) ((capacity) * 2)
+
+void initValueMap(ValueMap *map)
+{
+    map->count = 0;
+    map->used = 0;
+    map->capacity = 0;
+    map->entries = NULL;
+    map->index = NULL;
+}
+
+void freeValueMap(ValueMap *map)
+{
+    FREE_ARRAY(MapEntry, map->entries, map->capacity);
+    FREE_ARRAY(int32_t, map->index, INDEX_SIZE(map->capacity));
+
+    initValueMap(map);
+}
+
+// murmur3's finalizer, so nearby numbers and aligned pointers spread out
+static uint32_t hashBits(uint64_t bits)
+{
+    bits ^= vm.hashSeed;
+    bits ^= bits >> 33;
+    bits *= 0xff51afd7ed558ccdull;
+    bits ^= bits >> 33;
+    bits *= 0xc4ceb9fe1a85ec53ull;
+    bits ^= bits >> 33;
+
+    return (uint32_t)bits;
+}
+
+static uint32_t hashValue(Value value)
+{
+    switch (value.type)
+    {
+    case VAL_BOOL:
+        return hashBits(AS_BOOL(value) ? 2 : 1);
+    case VAL_NIL:
+        return hashBits(0);
+    case VAL_NUMBER:
+    {
+        double number = AS_NUMBER(value);
+        uint64_t bits;
+
+        // -0 == 0 and every NaN is the same key
+        if (number == 0)
+            number = 0;
+        else if (isnan(number))
+            number = NAN;
+
+        memcpy(&bits, &number, sizeof(bits));
+        return hashBits(bits);
+    }
+    case VAL_OBJ:
+        if (IS_STRING(value))
+            return hashObjString(AS_STRING(value));
+
+        return hashBits((uint64_t)(uintptr_t)AS_OBJ(value));
+    }
+
+    return 0;
+}
+
+static bool sameKey(Value a, Value b)
+{
+    if (IS_NUMBER(a) && IS_NUMBER(b))
+        return AS_NUMBER(a) == AS_NUMBER(b) || (isnan(AS_NUMBER(a)) && isnan(AS_NUMBER(b)));
+
+    return equal(a, b);
+}
+
+// returns the index slot that holds the key, or the empty one it would go in
+static int32_t *findSlot(ValueMap *map, Value key, uint32_t hash)
+{
+    uint32_t mask = INDEX_SIZE(map->capacity) - 1;
+
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        int32_t *slot = &map->index[i];
+
+        if (*slot == EMPTY_SLOT)
+            return slot;
+
+        MapEntry *entry = &map->entries[*slot];
+
+        // removed entries are skipped like tombstones
+        if (!entry->removed && entry->hash == hash && sameKey(entry->key, key))
+            return slot;
+    }
+}
+
+// moves the live entries (in order) to arrays of `capacity` entries and
+// rebuilds the index, dropping the removed ones
+static void resize(ValueMap *map, int capacity)
+{
+    MapEntry *entries = ALLOCATE(MapEntry, capacity);
+    int32_t *index = ALLOCATE(int32_t, INDEX_SIZE(capacity));
+    uint32_t mask = INDEX_SIZE(capacity) - 1;
+    int count = 0;
+
+    memset(index, 0xff, sizeof(int32_t) * INDEX_SIZE(capacity));
+
+    for (int i = 0; i < map->used; i++)
+    {
+        MapEntry *entry = &map->entries[i];
+
+        if (entry->removed)
+            continue;
+
+        uint32_t slot = entry->hash & mask;
+
+        while (index[slot] != EMPTY_SLOT)
+            slot = (slot + 1) & mask;
+
+        index[slot] = count;
+        entries[count++] = *entry;
+    }
+
+    FREE_ARRAY(MapEntry, map->entries, map->capacity);
+    FREE_ARRAY(int32_t, map->index, INDEX_SIZE(map->capacity));
+
+    map->entries = entries;
+    map->index = index;
+    map->capacity = capacity;
+    map->used = count;
+}
+
+bool valueMapGet(ValueMap *map, Value key, Value *value)
+{
+    if (map->count == 0)
+        return false;
+
+    int32_t *slot = findSlot(map, key, hashValue(key));
+
+    if (*slot == EMPTY_SLOT)
+        return false;
+
+    *value = map->entries[*slot].value;
+    return true;
+}
+
+// returns where the value of the key is stored, adding the key with a nil
+// value if it's missing, the pointer is only valid till the next insertion
+Value *valueMapSlot(ValueMap *map, Value key)
+{
+    uint32_t hash = hashValue(key);
+
+    if (map->capacity > 0)
+    {
+        int32_t *slot = findSlot(map, key, hash);
+
+        if (*slot != EMPTY_SLOT)
+            return &map->entries[*slot].value;
+    }
+
+    if (map->used == map->capacity)
+    {
+        int capacity = GROW_CAPACITY(map->capacity);
+
+        // compacting is enough if at most half of the entries are live
+        if (map->count * 2 < map->capacity)
+            capacity = map->capacity;
+
+        // the caller keeps the key and the map reachable but resizing
+        // shouldn't collect while the entries are only half moved
+        vm.deferGc++;
+        resize(map, capacity);
+        vm.deferGc--;
+    }
+
+    int32_t *slot = findSlot(map, key, hash);
+    MapEntry *entry = &map->entries[map->used];
+
+    entry->key = key;
+    entry->value = NIL;
+    entry->hash = hash;
+    entry->removed = false;
+
+    *slot = map->used++;
+    map->count++;
+
+    return &entry->value;
+}
+
+void valueMapSet(ValueMap *map, Value key, Value value)
+{
+    *valueMapSlot(map, key) = value;
+}
+
+// returns whether the key was there
+bool valueMapRemove(ValueMap *map, Value key)
+{
+    if (map->count == 0)
+        return false;
+
+    int32_t *slot = findSlot(map, key, hashValue(key));
+
+    if (*slot == EMPTY_SLOT)
+        return false;
+
+    MapEntry *entry = &map->entries[*slot];
+
+    // the slot keeps pointing to the entry so probes go past it
+    entry->removed = true;
+    entry->key = NIL;
+    entry->value = NIL;
+    map->count--;
+
+    if (map->count == 0)
+        freeValueMap(map);
+
+    return true;
+}
+
+// iterates the live entries in insertion order, `index` should start at 0
+MapEntry *valueMapNext(ValueMap *map, int *index)
+{
+    while (*index < map->used)
+    {
+        MapEntry *entry = &map->entries[(*index)++];
+
+        if (!entry->removed)
+            return entry;
+    }
+
+    return NULL;
+}
+
+#undef EMPTY_SLOT
+#undef INDEX_SIZE
@@ -0,0 +1,49 @@
+#ifndef clox_valuemap_h
+#define clox_valuemap_h
+
+#include "common.h"
+#include "value.h"
+
+typedef struct
+{
+    Value key;
+    Value value;
+    uint32_t hash;
+    bool removed;
+} MapEntry;
+
+/*
+    A hash table keyed by any value that remembers the insertion order, the
+    entries are appended to an array and a separate open-addressed index of
+    `int32_t`s points into it:
+        * numbers, bools, and nil are keyed by value (0 and -0 are the same
+          key and so are NaNs)
+        * strings by their characters
+        * every other object by its identity
+    Removed entries stay in the array (and the index) till it's compacted
+    when it fills up.
+*/
+typedef struct
+{
+    int count;    // live entries
+    int used;     // entries appended so far, removed ones included
+    int capacity; // of the entries, the index has twice as many slots
+    MapEntry *entries;
+    int32_t *index;
+} ValueMap;
+
+void initValueMap(ValueMap *);
+
+void freeValueMap(ValueMap *);
+
+bool valueMapGet(ValueMap *, Value, Value *);
+
+Value *valueMapSlot(ValueMap *, Value);
+
+void valueMapSet(ValueMap *, Value, Value);
+
+bool valueMapRemove(ValueMap *, Value);
+
+MapEntry *valueMapNext(ValueMap *, int *);
+
+#endif
@@ -1,8 +1,16 @@
 #include "vm.h"
 #include "reporter.h"
 #include "memory.h"
+#include "text.h"
+#include "number.h"
+#include "list.h"
+#include "map.h"
+#include "floatarray.h"
+#include "file.h"
 #include <string.h>
+#include <math.h>
 #include <time.h>
+#include <unistd.h>
 
 #ifdef DEBUG_BYTECODE
 #include "debug.h"
@@ -10,11 +18,13 @@
 
 Vm vm;
 
-static void runtimeError(char msg[])
+void runtimeError(char msg[])
 {
     CallFrame *frame = &vm.frames[vm.frameCount - 1];
+    Chunk *chunk = &frame->closure->function->chunk;
+    Token token = getTokenAt(chunk, (int)(frame->ip - chunk->code - 1));
 
-    report(REPORT_RUNTIME_ERROR, &frame->closure->function->chunk.tokenArr.tokens[(int)(frame->ip - frame->closure->function->chunk.code - 1)], msg);
+    report(REPORT_RUNTIME_ERROR, &token, msg);
 }
 
 //> NATIVE FUNCTIONS
@@ -30,13 +40,30 @@ bool nativePrint(Value *returnValue, Value *args)
     Value *arg = &args[1];
 
     printValue(*arg);
-    putchar('\n');
+    writeOutputChar(&vm.output, '\n');
 
     *returnValue = NIL;
 
     return true;
 }
 
+bool nativeFlush(Value *returnValue, Value *args)
+{
+    flushOutput(&vm.output);
+
+    *returnValue = NIL;
+
+    return true;
+}
+
+static ObjString *numberToString(double number)
+{
+    char buffer[NUMBER_BUFFER_SIZE];
+    int length = formatNumber(number, buffer);
+
+    return allocateUninternedObjString(buffer, length);
+}
+
 bool nativeInt(Value *returnValue, Value *args)
 {
     Value *arg = &args[1];
@@ -49,7 +76,7 @@ bool nativeInt(Value *returnValue, Value *args)
 
     ObjString *string = AS_STRING(*arg);
 
-    *returnValue = NUMBER(strtod(string->chars, NULL));
+    *returnValue = NUMBER(parseNumber(flattenString(string), string->length));
     return true;
 }
 
@@ -63,13 +90,149 @@ bool nativeString(Value *returnValue, Value *args)
         return false;
     }
 
-    char buffer[16];
-    sprintf(buffer, "%g", AS_NUMBER(*arg));
+    *returnValue = OBJ(numberToString(AS_NUMBER(*arg)));
 
-    *returnValue = OBJ((Obj *)allocateObjString(buffer, 16));
+    return true;
+}
 
+bool nativeMap(Value *returnValue, Value *args)
+{
+    *returnValue = OBJ(allocateObjMap());
     return true;
 }
+
+// takes either the length of an array of zeros or a list of numbers to copy
+bool nativeFloat64Array(Value *returnValue, Value *args)
+{
+    Value *arg = &args[1];
+
+    if (IS_NUMBER(*arg))
+    {
+        double length = AS_NUMBER(*arg);
+
+        if (length < 0 || length != floor(length))
+        {
+            runtimeError("The length should be a non-negative integer");
+            return false;
+        }
+
+        if (length > UINT32_MAX)
+        {
+            runtimeError("The length is too big");
+            return false;
+        }
+
+        *returnValue = OBJ(allocateObjFloatArray((size_t)length));
+        return true;
+    }
+
+    if (!IS_LIST(*arg))
+    {
+        runtimeError("The argument should be a length or a list");
+        return false;
+    }
+
+    ValueArr *items = &AS_LIST(*arg)->items;
+
+    for (size_t i = 0; i < items->count; i++)
+        if (!IS_NUMBER(items->values[i]))
+        {
+            runtimeError("The list should only have numbers");
+            return false;
+        }
+
+    // the list is still in `args` if allocating collects
+    ObjFloatArray *array = allocateObjFloatArray(items->count);
+
+    for (size_t i = 0; i < items->count; i++)
+        array->values[i] = AS_NUMBER(items->values[i]);
+
+    *returnValue = OBJ(array);
+    return true;
+}
+
+// `range(end)` counts from 0, `range(start, end, step)` goes by `step` (1 by
+// default) and like the other two never includes `end`
+bool nativeRange(Value *returnValue, Value *args)
+{
+    Value start = args[1], end = args[2], step = args[3];
+
+    if (IS_NIL(end))
+    {
+        end = start;
+        start = NUMBER(0);
+    }
+
+    if (IS_NIL(step))
+        step = NUMBER(1);
+
+    if (!IS_NUMBER(start) || !IS_NUMBER(end) || !IS_NUMBER(step))
+    {
+        runtimeError("The arguments should be numbers");
+        return false;
+    }
+
+    if (AS_NUMBER(step) == 0)
+    {
+        runtimeError("The step can't be zero");
+        return false;
+    }
+
+    double count = ceil((AS_NUMBER(end) - AS_NUMBER(start)) / AS_NUMBER(step));
+
+    if (count > INT32_MAX)
+    {
+        runtimeError("The range is too long");
+        return false;
+    }
+
+    // NaNs and ranges that go the wrong way are empty
+    if (!(count > 0))
+        count = 0;
+
+    ObjList *list = allocateObjList((int)count);
+
+    // every item is computed from the start so the error doesn't add up
+    for (int i = 0; i < (int)count; i++)
+        list->items.values[i] = NUMBER(AS_NUMBER(start) + i * AS_NUMBER(step));
+
+    list->items.count = (int)count;
+
+    *returnValue = OBJ(list);
+    return true;
+}
+
+static NativeDef natives[] = {
+    {"clock", (NativeFun)nativeClock, 0, 0},
+    {"print", (NativeFun)nativePrint, 1, 1},
+    {"flush", (NativeFun)nativeFlush, 0, 0},
+    {"int", (NativeFun)nativeInt, 1, 1},
+    {"string", (NativeFun)nativeString, 1, 1},
+    {"Map", (NativeFun)nativeMap, 0, 0},
+    {"Float64Array", (NativeFun)nativeFloat64Array, 1, 1},
+    {"range", (NativeFun)nativeRange, 1, 3},
+    {"open", (NativeFun)nativeOpen, 1, 1},
+};
+
+#define NATIVES_COUNT (sizeof(natives) / sizeof(NativeDef))
+
+NativeDef *findNativeByName(char *name, int length)
+{
+    for (int i = 0; i < NATIVES_COUNT; i++)
+        if (strlen(natives[i].name) == length && strncmp(natives[i].name, name, length) == 0)
+            return &natives[i];
+
+    return NULL;
+}
+
+NativeDef *findNativeByFunction(NativeFun function)
+{
+    for (int i = 0; i < NATIVES_COUNT; i++)
+        if (natives[i].function == function)
+            return &natives[i];
+
+    return NULL;
+}
 //<
 
 void push(Value value)
@@ -89,11 +252,32 @@ static Value get(int distance)
     return vm.stackTop[-1 - distance];
 }
 
-static void defineNative(char *name, NativeFun fun, uint8_t argsCount)
+// the natives that act as the methods of built-in objects, NULL for the rest
+static HashMap *builtinMethods(Value value)
+{
+    if (IS_STRING(value))
+        return &vm.stringMethods;
+
+    if (IS_LIST(value))
+        return &vm.listMethods;
+
+    if (IS_MAP(value))
+        return &vm.mapMethods;
+
+    if (IS_FLOAT_ARRAY(value))
+        return &vm.floatArrayMethods;
+
+    if (IS_FILE(value))
+        return &vm.fileMethods;
+
+    return NULL;
+}
+
+static void defineNative(HashMap *target, NativeDef *native)
 {
-    push(OBJ((Obj *)allocateObjString(name, strlen(name))));
-    push(OBJ((Obj *)allocateObjNative(argsCount, fun)));
-    hashMapInsert(&vm.globals, AS_STRING(get(1)), get(0));
+    push(OBJ((Obj *)allocateObjString(native->name, strlen(native->name))));
+    push(OBJ((Obj *)allocateObjNative(native->minArity, native->arity, native->function)));
+    hashMapInsert(target, AS_STRING(get(1)), get(0));
     pop();
     pop();
 }
@@ -101,6 +285,7 @@ static void defineNative(char *name, NativeFun fun, uint8_t argsCount)
 void initVm()
 {
     vm.frameCount = 0;
+    vm.frameBarrier = 0;
     vm.stackTop = vm.stack;
     vm.objects = NULL;
     vm.openUpValues = NULL;
@@ -110,14 +295,48 @@ void initVm()
     vm.grayCount = 0;
     vm.allocatedBytes = 0;
     vm.nextVm = 1024 * 1024;
+    vm.deferGc = 0;
+
+#ifdef FIXED_HASH_SEED
+    vm.hashSeed = 0;
+#else
+    // the address changes between runs too with ASLR
+    vm.hashSeed = (uint64_t)time(NULL) * 0x9e3779b97f4a7c15ull ^ (uint64_t)(uintptr_t)&vm;
+#endif
 
     initHashMap(&vm.globals);
     initHashMap(&vm.strings);
+    initHashMap(&vm.stringMethods);
+    initHashMap(&vm.listMethods);
+    initHashMap(&vm.mapMethods);
+    initHashMap(&vm.floatArrayMethods);
+    initHashMap(&vm.fileMethods);
+    initArena(&vm.arena);
+
+    // the debug flags print with printf so nothing can be held back
+#if defined(DEBUG_GC) || defined(DEBUG_BYTECODE) || defined(DEBUG_STRINGS_INTERNING)
+    initOutput(&vm.output, OUTPUT_DIRECT);
+#else
+    initOutput(&vm.output, isatty(STDOUT_FILENO) ? OUTPUT_LINE : OUTPUT_BLOCK);
+#endif
+
+    for (int i = 0; i < NATIVES_COUNT; i++)
+        defineNative(&vm.globals, &natives[i]);
+
+    for (int i = 0; i < stringMethodsCount; i++)
+        defineNative(&vm.stringMethods, &stringMethods[i]);
+
+    for (int i = 0; i < listMethodsCount; i++)
+        defineNative(&vm.listMethods, &listMethods[i]);
 
-    defineNative("clock", (NativeFun)nativeClock, 0);
-    defineNative("print", (NativeFun)nativePrint, 1);
-    defineNative("int", (NativeFun)nativeInt, 1);
-    defineNative("string", (NativeFun)nativeString, 1);
+    for (int i = 0; i < mapMethodsCount; i++)
+        defineNative(&vm.mapMethods, &mapMethods[i]);
+
+    for (int i = 0; i < floatArrayMethodsCount; i++)
+        defineNative(&vm.floatArrayMethods, &floatArrayMethods[i]);
+
+    for (int i = 0; i < fileMethodsCount; i++)
+        defineNative(&vm.fileMethods, &fileMethods[i]);
 }
 
 static uint8_t next()
@@ -216,15 +435,22 @@ bool call(Value value, int argsCount)
         {
             ObjNative *function = (ObjNative *)obj;
 
-            if (function->arity != argsCount)
+            if (argsCount < function->minArity || argsCount > function->arity)
             {
                 char msg[160];
-                sprintf(msg, "Expected %d argument%s but got %d", function->arity, function->arity == 1 ? "" : "s", argsCount);
+
+                if (function->minArity == function->arity)
+                    sprintf(msg, "Expected %d argument%s but got %d", function->arity, function->arity == 1 ? "" : "s", argsCount);
+                else
+                    sprintf(msg, "Expected %d to %d arguments but got %d", function->minArity, function->arity, argsCount);
 
                 runtimeError(msg);
                 return false;
             }
 
+            for (; argsCount < function->arity; argsCount++)
+                push(NIL);
+
             Value returnValue;
             if (!function->function(&returnValue, vm.stackTop - function->arity - 1))
                 return false;
@@ -274,18 +500,24 @@ ObjString *concat(ObjString *s1, ObjString *s2)
 {
     size_t length = s1->length + s2->length;
 
-    char *temp = malloc(length);
+    // the operands aren't on the stack anymore
+    vm.deferGc++;
 
-    temp[0] = '\0';
-
-    strcpy(temp, s1->chars);
-    strcat(temp, s2->chars);
+    // long strings are only copied once they're needed (see `flattenString`)
+    if (length >= ROPE_MIN_LENGTH)
+    {
+        ObjString *rope = allocateObjRope(s1, s2);
+        vm.deferGc--;
+        return rope;
+    }
 
-    ObjString *string = allocateObjString(temp, length);
+    ObjString *string = reserveObjString(length);
+    vm.deferGc--;
 
-    free(temp);
+    memcpy(string->chars, flattenString(s1), s1->length);
+    memcpy(string->chars + s1->length, flattenString(s2), s2->length);
 
-    return string;
+    return trackObjString(string);
 }
 
 Result run()
@@ -355,6 +587,19 @@ Result run()
                 push(NUMBER(AS_NUMBER(a) + AS_NUMBER(b)));
             else if (IS_STRING(a) && IS_STRING(b))
                 push(OBJ(concat(AS_STRING(a), AS_STRING(b))));
+            else if (IS_STRING(a) && IS_NUMBER(b))
+            {
+                // the string operand isn't on the stack anymore
+                vm.deferGc++;
+                push(OBJ(concat(AS_STRING(a), numberToString(AS_NUMBER(b)))));
+                vm.deferGc--;
+            }
+            else if (IS_NUMBER(a) && IS_STRING(b))
+            {
+                vm.deferGc++;
+                push(OBJ(concat(numberToString(AS_NUMBER(a)), AS_STRING(b))));
+                vm.deferGc--;
+            }
             else if (IS_STRING(a))
             { //>>IMPLEMENT
                 runtimeError("Concatinating strings with other types isn't supported yet");
@@ -513,7 +758,7 @@ Result run()
             // updates the current frame
             frame = &vm.frames[vm.frameCount - 1];
 
-            if (vm.frameCount == 0)
+            if (vm.frameCount == vm.frameBarrier)
             {
                 return RESULT_SUCCESS;
             }
@@ -676,9 +921,87 @@ Result run()
                         value = NUMBER((double)string->length);
                         goto pushValue;
                     }
+                    else if (hashMapGet(&vm.stringMethods, key) != NULL)
+                    {
+                        runtimeError("String methods can only be called directly");
+                        return RESULT_RUNTIME_ERROR;
+                    }
+                    else
+                    {
+                        runtimeError("Undefined property");
+                        return RESULT_RUNTIME_ERROR;
+                    }
+                }
+                case OBJ_LIST:
+                {
+                    char length[] = "length";
+
+                    if (key->length == strlen(length) && strcmp(key->chars, length) == 0)
+                    {
+                        value = NUMBER((double)AS_LIST(obj)->items.count);
+                        goto pushValue;
+                    }
+                    else if (hashMapGet(&vm.listMethods, key) != NULL)
+                    {
+                        runtimeError("List methods can only be called directly");
+                        return RESULT_RUNTIME_ERROR;
+                    }
                     else
                     {
-                        runtimeError("String class isn't yet implemented");
+                        runtimeError("Undefined property");
+                        return RESULT_RUNTIME_ERROR;
+                    }
+                }
+                case OBJ_MAP:
+                {
+                    char size[] = "size";
+
+                    if (key->length == strlen(size) && strcmp(key->chars, size) == 0)
+                    {
+                        value = NUMBER((double)AS_MAP(obj)->entries.count);
+                        goto pushValue;
+                    }
+                    else if (hashMapGet(&vm.mapMethods, key) != NULL)
+                    {
+                        runtimeError("Map methods can only be called directly");
+                        return RESULT_RUNTIME_ERROR;
+                    }
+                    else
+                    {
+                        runtimeError("Undefined property");
+                        return RESULT_RUNTIME_ERROR;
+                    }
+                }
+                case OBJ_FLOAT_ARRAY:
+                {
+                    char length[] = "length";
+
+                    if (key->length == strlen(length) && strcmp(key->chars, length) == 0)
+                    {
+                        value = NUMBER((double)AS_FLOAT_ARRAY(obj)->length);
+                        goto pushValue;
+                    }
+                    else if (hashMapGet(&vm.floatArrayMethods, key) != NULL)
+                    {
+                        runtimeError("Float array methods can only be called directly");
+                        return RESULT_RUNTIME_ERROR;
+                    }
+                    else
+                    {
+                        runtimeError("Undefined property");
+                        return RESULT_RUNTIME_ERROR;
+                    }
+                }
+                case OBJ_FILE:
+                {
+                    if (hashMapGet(&vm.fileMethods, key) != NULL)
+                    {
+                        runtimeError("File methods can only be called directly");
+                        return RESULT_RUNTIME_ERROR;
+                    }
+                    else
+                    {
+                        runtimeError("Undefined property");
                         return RESULT_RUNTIME_ERROR;
                     }
                 }
@@ -687,7 +1010,7 @@ Result run()
             }
             default:
             {
-                runtimeError("Getters can only be used with strings, instances, and classes");
+                runtimeError("Getters can only be used with strings, lists, maps, float arrays, files, instances, and classes");
                 return RESULT_RUNTIME_ERROR;
             }
             }
@@ -756,10 +1079,34 @@ Result run()
             // TODO make 'this' be of type 'Value'
             ObjString *key = nextAsString();
             uint8_t argsCount = next();
-            ObjInstance *instance = AS_INSTANCE(get(argsCount));
-
+            Value receiver = get(argsCount);
             Value *value;
 
+            HashMap *methods = builtinMethods(receiver);
+
+            // methods of built-in objects are natives that get the receiver in place of the callee
+            if (methods != NULL)
+            {
+                if ((value = hashMapGet(methods, key)) == NULL)
+                {
+                    runtimeError("Undefined method");
+                    return RESULT_RUNTIME_ERROR;
+                }
+
+                if (!call(*value, argsCount))
+                    return RESULT_RUNTIME_ERROR;
+
+                break;
+            }
+
+            if (!IS_INSTANCE(receiver))
+            {
+                runtimeError("Only instances, strings, lists, maps, float arrays, and files have methods");
+                return RESULT_RUNTIME_ERROR;
+            }
+
+            ObjInstance *instance = AS_INSTANCE(receiver);
+
             if ((value = hashMapGet(&instance->fields, key)) != NULL)
             {
 
@@ -834,6 +1181,99 @@ Result run()
             return RESULT_RUNTIME_ERROR;
         }
 
+        case OP_LIST:
+        {
+            uint8_t count = next();
+            ObjList *list = allocateObjList(count);
+
+            // the items stay on the stack till the list is allocated, and an
+            // empty list has no array to copy into
+            if (count > 0)
+                memcpy(list->items.values, vm.stackTop - count, sizeof(Value) * count);
+            list->items.count = count;
+            vm.stackTop -= count;
+
+            push(OBJ(list));
+            break;
+        }
+
+        case OP_GET_INDEX:
+        {
+            Value target = get(1);
+            Value value;
+            size_t index;
+
+            if (IS_LIST(target))
+            {
+                if (!readArrayIndex(get(0), AS_LIST(target)->items.count, &index))
+                    return RESULT_RUNTIME_ERROR;
+
+                value = AS_LIST(target)->items.values[index];
+            }
+            else if (IS_FLOAT_ARRAY(target))
+            {
+                if (!readArrayIndex(get(0), AS_FLOAT_ARRAY(target)->length, &index))
+                    return RESULT_RUNTIME_ERROR;
+
+                value = NUMBER(AS_FLOAT_ARRAY(target)->values[index]);
+            }
+            // missing keys give nil
+            else if (IS_MAP(target))
+            {
+                if (!valueMapGet(&AS_MAP(target)->entries, get(0), &value))
+                    value = NIL;
+            }
+            else
+            {
+                runtimeError("Only lists, maps, and float arrays can be indexed");
+                return RESULT_RUNTIME_ERROR;
+            }
+
+            vm.stackTop -= 2;
+            push(value);
+            break;
+        }
+
+        case OP_SET_INDEX:
+        {
+            Value target = get(2);
+            Value value = get(0);
+            size_t index;
+
+            if (IS_LIST(target))
+            {
+                if (!readArrayIndex(get(1), AS_LIST(target)->items.count, &index))
+                    return RESULT_RUNTIME_ERROR;
+
+                AS_LIST(target)->items.values[index] = value;
+            }
+            else if (IS_FLOAT_ARRAY(target))
+            {
+                if (!readArrayIndex(get(1), AS_FLOAT_ARRAY(target)->length, &index))
+                    return RESULT_RUNTIME_ERROR;
+
+                if (!IS_NUMBER(value))
+                {
+                    runtimeError("Float arrays can only hold numbers");
+                    return RESULT_RUNTIME_ERROR;
+                }
+
+                AS_FLOAT_ARRAY(target)->values[index] = AS_NUMBER(value);
+            }
+            // the key and the value stay on the stack while the map grows
+            else if (IS_MAP(target))
+                valueMapSet(&AS_MAP(target)->entries, get(1), value);
+            else
+            {
+                runtimeError("Only lists, maps, and float arrays can be indexed");
+                return RESULT_RUNTIME_ERROR;
+            }
+
+            vm.stackTop -= 3;
+            push(value);
+            break;
+        }
+
         default:;
         }
     }
@@ -842,6 +1282,51 @@ Result run()
 #undef NUMERIC_BINARY_OP
 }
 
+// calls the callee below the `argsCount` arguments on top of the stack and runs
+// it till it returns, the result replaces the callee and the arguments like it
+// does for `OP_CALL`
+static bool callNested(int argsCount)
+{
+    int barrier = vm.frameBarrier;
+    bool succeeded;
+
+    vm.frameBarrier = vm.frameCount;
+
+    // natives and classes without initializers return right away
+    succeeded = call(get(argsCount), argsCount) && (vm.frameCount == vm.frameBarrier || run() == RESULT_SUCCESS);
+
+    vm.frameBarrier = barrier;
+
+    return succeeded;
+}
+
+// lets natives call back into Lox, the callee and its arguments are copied to
+// the stack first so the GC sees them wherever they came from, on errors (that
+// are already reported) the frames and the stack of the call are unwound
+bool vmCallValue(Value callee, int argsCount, Value *args, Value *out)
+{
+    Value *base = vm.stackTop;
+    int frameCount = vm.frameCount;
+
+    push(callee);
+
+    for (int i = 0; i < argsCount; i++)
+        push(args[i]);
+
+    if (!callNested(argsCount))
+    {
+        closeUpValue(base);
+        vm.frameCount = frameCount;
+        vm.stackTop = base;
+        return false;
+    }
+
+    *out = pop();
+    return true;
+}
+
 void freeVm()
 {
+    flushOutput(&vm.output);
+    freeArena(&vm.arena);
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include "value.h"
 #include "object.h"
 #include "hashmap.h"
+#include "arena.h"
+#include "output.h"
 
 #define FRAMES_MAX 64
 #define STACK_MAX (FRAMES_MAX * (UINT8_MAX + 1))
@@ -21,6 +23,7 @@ typedef struct Vm
 {
     CallFrame frames[FRAMES_MAX];
     int frameCount;
+    int frameBarrier; // `run` returns when a return brings `frameCount` down to it
 
     Value stack[STACK_MAX];
     Value *stackTop;
@@ -29,6 +32,20 @@ typedef struct Vm
     HashMap globals;
 
     HashMap strings;
+    uint64_t hashSeed;
+
+    // methods of strings, lists, maps, float arrays, and files by name (natives)
+    HashMap stringMethods;
+    HashMap listMethods;
+    HashMap mapMethods;
+    HashMap floatArrayMethods;
+    HashMap fileMethods;
+
+    // scratch memory the compiler builds chunks in
+    Arena arena;
+
+    // what `print` writes to
+    Output output;
 
     // these three fields are only used in the garbage-collector
     int grayCount;
@@ -36,16 +53,33 @@ typedef struct Vm
     Obj **gray;
     size_t allocatedBytes;
     size_t nextVm;
+    int deferGc; // collections are postponed while it's above zero
 } Vm;
 
+typedef struct
+{
+    char *name;
+    NativeFun function;
+    uint8_t minArity;
+    uint8_t arity;
+} NativeDef;
+
 void initVm();
 
+void runtimeError(char[]);
+
 bool call(Value, int);
 
 Result run();
 
+bool vmCallValue(Value, int, Value *, Value *);
+
 void freeVm();
 
+NativeDef *findNativeByName(char *, int);
+
+NativeDef *findNativeByFunction(NativeFun);
+
 void push(Value value);
 
 Value pop();